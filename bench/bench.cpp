@@ -0,0 +1,649 @@
+// synesthesia_bench: micro and end-to-end benchmarks, JSON results.
+//
+//   synesthesia_bench [--json out.json] [--filter substr] [--assets dir]
+//                     [--synthetic-sec s] [--min-time s]
+//
+// Also checks that the analysis hot paths make no heap allocation once warm
+// (allocs/* results); the exit status is 2 if any does.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <new>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "analysis.h"
+#include "decoder.h"
+#include "fourier.h"
+#include "input.h"
+#include "mp3_index.h"
+#include "multichannel.h"
+#include "multires.h"
+#include "offline.h"
+#include "ring_buffer.h"
+#include "scheduler.h"
+#include "spatial.h"
+#include "tracker.h"
+#include "signals.h"
+
+// Every operator new in the process, for the allocs/* checks. The aligned
+// forms count too: they serve the alignas(64) analyzer buffers. Not inlined,
+// so the compiler does not pair malloc with a sized delete at call sites.
+static std::atomic<uint64_t> g_heap_allocs{0};
+
+[[gnu::noinline]] static void *counted_alloc(std::size_t n, std::size_t align)
+{
+    g_heap_allocs.fetch_add(1, std::memory_order_relaxed);
+    n = n ? n : 1;
+    void *p = align > alignof(std::max_align_t) ? std::aligned_alloc(align, (n + align - 1) / align * align)
+                                                : std::malloc(n);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+[[gnu::noinline]] static void counted_free(void *p) noexcept { std::free(p); }
+
+void *operator new(std::size_t n) { return counted_alloc(n, 0); }
+void *operator new(std::size_t n, std::align_val_t a) { return counted_alloc(n, (std::size_t)a); }
+void operator delete(void *p) noexcept { counted_free(p); }
+void operator delete(void *p, std::size_t) noexcept { counted_free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { counted_free(p); }
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept { counted_free(p); }
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+template <typename T>
+inline void keep(const T &v)
+{
+    asm volatile("" : : "g"(&v) : "memory");
+}
+
+struct Result
+{
+    std::string name;
+    double ns_per_op = 0.0;
+    uint64_t iters = 0;
+    double audio_sec = 0.0; // end-to-end only
+    double x_realtime = 0.0;
+    int64_t allocs = -1; // allocs/* only
+};
+
+struct Bench
+{
+    std::string filter;
+    double min_time = 0.2;
+    std::vector<Result> results;
+
+    bool enabled(const std::string &name) const
+    {
+        return filter.empty() || name.find(filter) != std::string::npos;
+    }
+
+    // Median ns/op over 5 batches, each batch at least min_time / 5
+    void run(const std::string &name, const std::function<void()> &f)
+    {
+        if (!enabled(name))
+            return;
+        f(); // warm caches and lazy state
+        uint64_t per_batch = 1;
+        for (;;)
+        {
+            auto t0 = Clock::now();
+            for (uint64_t i = 0; i < per_batch; ++i)
+                f();
+            double s = std::chrono::duration<double>(Clock::now() - t0).count();
+            if (s >= min_time / 5 || per_batch > (1ull << 30))
+                break;
+            per_batch *= 2;
+        }
+        std::vector<double> ns;
+        for (int b = 0; b < 5; ++b)
+        {
+            auto t0 = Clock::now();
+            for (uint64_t i = 0; i < per_batch; ++i)
+                f();
+            ns.push_back(std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / per_batch);
+        }
+        std::sort(ns.begin(), ns.end());
+        Result r;
+        r.name = name;
+        r.ns_per_op = ns[2];
+        r.iters = per_batch * 5;
+        results.push_back(r);
+        std::fprintf(stderr, "%-36s %14.1f ns/op\n", name.c_str(), r.ns_per_op);
+    }
+
+    // Heap allocations made by `iters` calls of f after `warmup` calls
+    uint64_t count_allocs(const std::string &name, int warmup, int iters, const std::function<void()> &f)
+    {
+        if (!enabled(name))
+            return 0;
+        for (int i = 0; i < warmup; ++i)
+            f();
+        uint64_t before = g_heap_allocs.load(std::memory_order_relaxed);
+        for (int i = 0; i < iters; ++i)
+            f();
+        uint64_t n = g_heap_allocs.load(std::memory_order_relaxed) - before;
+        Result r;
+        r.name = name;
+        r.iters = (uint64_t)iters;
+        r.allocs = (int64_t)n;
+        results.push_back(r);
+        std::fprintf(stderr, "%-36s %14llu allocations in %d calls%s\n", name.c_str(), (unsigned long long)n, iters,
+                     n ? "  <-- expected 0" : "");
+        return n;
+    }
+
+    void add_pass(const std::string &name, double wall_sec, double audio_sec)
+    {
+        Result r;
+        r.name = name;
+        r.ns_per_op = wall_sec * 1e9;
+        r.iters = 1;
+        r.audio_sec = audio_sec;
+        r.x_realtime = audio_sec / std::max(wall_sec, 1e-12);
+        results.push_back(r);
+        std::fprintf(stderr, "%-36s %8.3f s for %8.1f s audio (%.1fx realtime)\n", name.c_str(), wall_sec, audio_sec,
+                     r.x_realtime);
+    }
+};
+
+void bench_kernels(Bench &b)
+{
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> uni(-1.0f, 1.0f);
+    const int rate = 48000;
+
+    for (int n : {1024, 4096, 16384})
+    {
+        std::vector<cd> a(n), src(n);
+        for (cd &v : src)
+            v = cd(uni(rng), 0.0);
+        b.run("fft_inplace/" + std::to_string(n), [&] {
+            a = src;
+            fft_inplace(a);
+            keep(a[0]);
+        });
+
+        std::vector<double> x(n);
+        for (double &v : x)
+            v = uni(rng);
+        std::vector<cd> X(n / 2 + 1);
+        std::vector<float> xf(x.begin(), x.end());
+        std::vector<cf> Xf(n / 2 + 1);
+        for (FftIsa isa : {FftIsa::Scalar, fft_detect_isa()})
+        {
+            RealFft fft(n, isa);
+            b.run("real_fft/" + std::string(fft_isa_name(isa)) + "/" + std::to_string(n), [&] {
+                fft.forward(x.data(), X.data());
+                keep(X[0]);
+            });
+            RealFftF fft_f(n, isa);
+            b.run("real_fft_f32/" + std::string(fft_isa_name(isa)) + "/" + std::to_string(n), [&] {
+                fft_f.forward(xf.data(), Xf.data());
+                keep(Xf[0]);
+            });
+            if (isa == fft_detect_isa())
+                break;
+        }
+    }
+
+    const int N = 2 << 13;
+    std::vector<double> hann(N);
+    b.run("make_hann/16384", [&] {
+        make_hann(hann);
+        keep(hann[0]);
+    });
+
+    // A realistic dB spectrum: a Hann-windowed chord
+    std::vector<float> L(N), R(N);
+    SignalGenerator gen(rate);
+    std::vector<float> skip(rate * 10);
+    gen.fill(skip.data(), skip.data(), skip.size()); // into the chord scene
+    gen.fill(L.data(), R.data(), N);
+    std::vector<double> xw(N);
+    for (int n = 0; n < N; ++n)
+        xw[n] = 0.5 * (L[n] + R[n]) * hann[n];
+    std::vector<cd> X(N / 2 + 1);
+    RealFft fft(N);
+    fft.forward(xw.data(), X.data());
+    std::vector<double> mag_db(N / 2 + 1);
+    for (int k = 0; k <= N / 2; ++k)
+        mag_db[k] = 20.0 * std::log10(std::max(std::abs(X[k]) / (N * 0.5), 1e-12));
+
+    // Magnitude stage: per-bin std::abs + std::log10 against the fused kernel
+    std::vector<double> mag_ref(N / 2 + 1);
+    b.run("magnitude_db/log10/8193", [&] {
+        for (int k = 0; k <= N / 2; ++k)
+            mag_ref[k] = 20.0 * std::log10(std::abs(X[k]) / (N * 0.5));
+        keep(mag_ref[0]);
+    });
+    std::vector<cf> Xf(X.begin(), X.end());
+    std::vector<float> mag_f(N / 2 + 1);
+    for (FftIsa isa : {FftIsa::Scalar, fft_detect_isa()})
+    {
+        b.run("magnitude_db/f32/" + std::string(fft_isa_name(isa)) + "/8193", [&] {
+            magnitude_db(Xf.data(), Xf.size(), N * 0.5f, mag_f.data(), isa);
+            keep(mag_f[0]);
+        });
+        if (isa == fft_detect_isa())
+            break;
+    }
+
+    b.run("peaks_selector/16384", [&] {
+        auto peaks = peaks_selector(mag_db, -50, 3);
+        keep(peaks);
+    });
+    auto peaks = peaks_selector(mag_db, -50, 3);
+    int bin = peaks.empty() ? 100 : peaks[0].first;
+    b.run("interp_quadratic_bin", [&] {
+        double k = interp_quadratic_bin(mag_db, bin);
+        keep(k);
+    });
+    double freq = interp_quadratic_bin(mag_db, bin) * rate / N;
+    b.run("timbre_harmonics", [&] {
+        auto t = timbre_harmonics(mag_db, freq, rate, N);
+        keep(t);
+    });
+
+    b.run("energy/16384", [&] {
+        double l2, r2;
+        energy(L.data(), R.data(), N, &l2, &r2);
+        keep(l2);
+        keep(r2);
+    });
+    b.run("width_from_mid_side/16384", [&] {
+        double w = width_from_mid_side(L.data(), R.data(), N);
+        keep(w);
+    });
+    b.run("spatial_sums/16384", [&] {
+        SpatialSums s;
+        s.add(L.data(), R.data(), N);
+        keep(s);
+    });
+    {
+        // Steady state: the window slides by one hop per call
+        const int hop = AnalysisParams{}.hop;
+        SpatialAccumulator acc(N, hop);
+        uint64_t sample = 0;
+        b.run("spatial_accumulator/16384+4096", [&] {
+            SpatialSums s = acc.update(L.data(), R.data(), sample);
+            sample += hop;
+            keep(s);
+        });
+    }
+    const int maxLag = (int)std::round(0.001 * rate);
+    b.run("xcorr_argmax_lag/16384", [&] {
+        int lag = xcorr_argmax_lag(L.data(), R.data(), N, maxLag);
+        keep(lag);
+    });
+    GccPhat gcc(N, rate);
+    b.run("gcc_phat/16384", [&] {
+        double lag = gcc.lag(L.data(), R.data(), maxLag);
+        keep(lag);
+    });
+
+    // 5.1 window: second-order statistics of all 15 pairs with the stereo
+    // helpers, against one fused covariance pass over the interleaved frames
+    const int C = 6;
+    std::vector<float> x51((size_t)C * N), planar((size_t)C * N);
+    for (int n = 0; n < N; ++n)
+        for (int c = 0; c < C; ++c)
+            x51[(size_t)n * C + c] = (c & 1 ? R[n] : L[n]) * (1.0f - 0.1f * c);
+    for (int c = 0; c < C; ++c)
+        for (int n = 0; n < N; ++n)
+            planar[(size_t)c * N + n] = x51[(size_t)n * C + c];
+    b.run("spatial_pairs/stereo/6x16384", [&] {
+        double acc = 0.0;
+        for (int i = 0; i < C; ++i)
+            for (int j = i + 1; j < C; ++j)
+            {
+                double e1, e2;
+                energy(&planar[(size_t)i * N], &planar[(size_t)j * N], N, &e1, &e2);
+                acc += e1 + e2 + width_from_mid_side(&planar[(size_t)i * N], &planar[(size_t)j * N], N);
+            }
+        keep(acc);
+    });
+    std::vector<double> cov(C * C);
+    for (FftIsa isa : {FftIsa::Scalar, fft_detect_isa()})
+    {
+        b.run("channel_covariance/" + std::string(fft_isa_name(isa)) + "/6x16384", [&] {
+            std::fill(cov.begin(), cov.end(), 0.0);
+            channel_covariance(x51.data(), C, N, cov.data(), planar.data(), isa);
+            keep(cov[0]);
+        });
+        if (isa == fft_detect_isa())
+            break;
+    }
+    MultiChannelAnalyzer analyzer51(rate, ChannelLayout::from_mask(0, C));
+    b.run("multichannel_analyzer/6x16384", [&] {
+        MultiHopFeatures f = analyzer51.analyze(x51.data(), 0);
+        keep(f);
+    });
+
+    HopAnalyzer analyzer(rate);
+    std::vector<float> M(N);
+    for (int n = 0; n < N; ++n)
+        M[n] = 0.5f * (L[n] + R[n]);
+    std::vector<CircleEvent> events;
+    b.run("hop_analyzer/16384", [&] {
+        events.clear();
+        HopFeatures f = analyzer.analyze(L.data(), R.data(), M.data(), 0, events);
+        keep(f);
+    });
+    AnalysisParams f64;
+    f64.single_precision = false;
+    HopAnalyzer analyzer_f64(rate, f64);
+    b.run("hop_analyzer/16384/f64", [&] {
+        events.clear();
+        HopFeatures f = analyzer_f64.analyze(L.data(), R.data(), M.data(), 0, events);
+        keep(f);
+    });
+
+    // Smaller --fft-size windows (hop N/4) on the same plans
+    for (int n : {1024, 2048, 4096})
+    {
+        AnalysisParams p;
+        p.N = n;
+        p.hop = n / kStftOverlap;
+        HopAnalyzer small(rate, p);
+        b.run("hop_analyzer/" + std::to_string(n), [&] {
+            events.clear();
+            HopFeatures f = small.analyze(L.data(), R.data(), M.data(), 0, events);
+            keep(f);
+        });
+    }
+
+    // One decoded frame of tracking for the partials of that hop
+    events.clear();
+    analyzer.analyze(L.data(), R.data(), M.data(), 0, events);
+    PartialTracker tracker(rate);
+    tracker.track(events);
+    b.run("partial_tracker/update", [&] {
+        tracker.update(M.data() + N - tracker.window(), 0);
+        keep(tracker);
+    });
+}
+
+// Decode + analysis of every bundled MP3, nothing rendered or played
+// Frame index of one file, its decode sequential and parallel, and the
+// latency of decoding one frame at a random position (warm-up included)
+void bench_mp3_decode(Bench &b, const std::string &path, WorkStealingPool &pool)
+{
+    const std::string file = std::filesystem::path(path).filename().string();
+    std::unique_ptr<MappedFile> input;
+    try
+    {
+        input = std::make_unique<MappedFile>(path);
+    }
+    catch (const std::exception &)
+    {
+        return;
+    }
+    const uint8_t *data = input->data();
+    const size_t size = input->size();
+
+    Mp3Index index = Mp3Index::build(data, size);
+    if (index.empty())
+        return;
+    b.run("mp3_index/" + file, [&] { index = Mp3Index::build(data, size); });
+
+    std::vector<int16_t> pcm(index.pcm_values(0, index.size()));
+    std::vector<uint16_t> counts(index.size());
+    const double audio_sec = double(index.samples()) / index.rate();
+    auto pass = [&](const std::string &name, const std::function<bool()> &decode) {
+        if (!b.enabled(name))
+            return;
+        auto t0 = Clock::now();
+        if (decode())
+            b.add_pass(name, std::chrono::duration<double>(Clock::now() - t0).count(), audio_sec);
+    };
+    pass("mp3_decode/sequential/" + file,
+         [&] { return decode_frames(data, size, index, 0, index.size(), 0, pcm.data(), counts.data()); });
+    pass("mp3_decode/parallel/" + file,
+         [&] { return decode_parallel(data, size, index, 0, index.size(), pool, pcm.data(), counts.data()); });
+
+    std::mt19937_64 rng(5);
+    std::vector<int16_t> frame(index.pcm_values(0, 1) * 2);
+    uint16_t n = 0;
+    b.run("mp3_seek/" + file, [&] {
+        const size_t i = index.frame_at(rng() % index.samples());
+        frame.resize(index.pcm_values(i, i + 1));
+        decode_frames(data, size, index, i, i + 1, index.warmup_start(i), frame.data(), &n);
+        keep(n);
+    });
+}
+
+void bench_assets(Bench &b, const std::string &dir)
+{
+    struct NullSink : HopSink
+    {
+        void hop(const HopFeatures &, const CircleEvent *, uint32_t) override {}
+    };
+
+    std::error_code ec;
+    std::vector<std::string> files;
+    for (const auto &e : std::filesystem::directory_iterator(dir, ec))
+        if (e.path().extension() == ".mp3")
+            files.push_back(e.path().string());
+    std::sort(files.begin(), files.end());
+
+    for (const std::string &f : files)
+    {
+        std::string name = "decode_analysis/" + std::filesystem::path(f).filename().string();
+        if (!b.enabled(name))
+            continue;
+        NullSink sink;
+        FileStats st = analyze_stream(f, AnalysisParams{}, sink);
+        if (st.ok)
+            b.add_pass(name, st.wall_sec, st.audio_sec);
+    }
+
+    WorkStealingPool pool((int)std::max(1u, std::thread::hardware_concurrency()));
+    for (const std::string &f : files)
+        bench_mp3_decode(b, f, pool);
+}
+
+// Streaming analysis of generated audio, same ring/hop flow as audio_thread
+void bench_synthetic(Bench &b, double seconds)
+{
+    const std::string name = "synthetic_analysis";
+    if (seconds <= 0.0 || !b.enabled(name))
+        return;
+    const int rate = 48000;
+    const int frame = 1152;
+    HopAnalyzer analyzer(rate);
+    const int N = analyzer.params().N, HOP = analyzer.params().hop;
+    SampleRing<float> left(N + frame, N), right(N + frame, N), mid(N + frame, N);
+    SignalGenerator gen(rate);
+    float L[frame], R[frame], M[frame];
+    std::vector<CircleEvent> events;
+    uint64_t hop_sample = 0;
+
+    const uint64_t total = (uint64_t)(seconds * rate);
+    auto t0 = Clock::now();
+    for (uint64_t done = 0; done < total; done += frame)
+    {
+        gen.fill(L, R, frame);
+        for (int i = 0; i < frame; ++i)
+            M[i] = 0.5f * (L[i] + R[i]);
+        left.push(L, frame);
+        right.push(R, frame);
+        mid.push(M, frame);
+        while (mid.size() >= (size_t)N)
+        {
+            events.clear();
+            HopFeatures f = analyzer.analyze(left.peek(), right.peek(), mid.peek(), hop_sample, events);
+            keep(f);
+            hop_sample += HOP;
+            left.consume(HOP);
+            right.consume(HOP);
+            mid.consume(HOP);
+        }
+    }
+    double wall = std::chrono::duration<double>(Clock::now() - t0).count();
+    b.add_pass(name, wall, double(total) / rate);
+}
+
+// Same audio through the multi-resolution analyzer, one decoded frame at a time
+void bench_synthetic_multires(Bench &b, double seconds)
+{
+    const std::string name = "synthetic_analysis_multires";
+    if (seconds <= 0.0 || !b.enabled(name))
+        return;
+    const int rate = 48000;
+    const int frame = 1152;
+    MultiResAnalyzer analyzer(rate);
+    SignalGenerator gen(rate);
+    float L[frame], R[frame], M[frame];
+    std::vector<CircleEvent> events;
+
+    const uint64_t total = (uint64_t)(seconds * rate);
+    auto t0 = Clock::now();
+    for (uint64_t done = 0; done < total; done += frame)
+    {
+        gen.fill(L, R, frame);
+        for (int i = 0; i < frame; ++i)
+            M[i] = 0.5f * (L[i] + R[i]);
+        events.clear();
+        analyzer.push(L, R, M, frame, events);
+        keep(events);
+    }
+    double wall = std::chrono::duration<double>(Clock::now() - t0).count();
+    b.add_pass(name, wall, double(total) / rate);
+}
+
+// Steady state of each hot path must not allocate; returns the total found
+uint64_t bench_allocations(Bench &b)
+{
+    const int rate = 48000;
+    const int N = 2 << 13;
+    const int frame = 1152;
+    SignalGenerator gen(rate);
+    std::vector<float> L(rate * 20), R(rate * 20), M(rate * 20);
+    gen.fill(L.data(), R.data(), L.size());
+    for (size_t i = 0; i < M.size(); ++i)
+        M[i] = 0.5f * (L[i] + R[i]);
+    std::vector<CircleEvent> events;
+    events.reserve(64);
+    uint64_t total = 0;
+
+    for (bool f32 : {true, false})
+    {
+        AnalysisParams p;
+        p.single_precision = f32;
+        HopAnalyzer analyzer(rate, p);
+        size_t off = 0;
+        total += b.count_allocs(f32 ? "allocs/hop_analyzer" : "allocs/hop_analyzer/f64", 4, 40, [&] {
+            events.clear();
+            analyzer.analyze(L.data() + off, R.data() + off, M.data() + off, off, events);
+            off = (off + p.hop) % (L.size() - N);
+        });
+    }
+
+    {
+        MultiResAnalyzer analyzer(rate);
+        size_t off = 0;
+        total += b.count_allocs("allocs/multires", 1000, 400, [&] {
+            events.clear();
+            analyzer.push(L.data() + off, R.data() + off, M.data() + off, frame, events);
+            off = (off + frame) % (L.size() - frame);
+        });
+    }
+
+    {
+        HopAnalyzer analyzer(rate);
+        PartialTracker tracker(rate);
+        size_t off = 0;
+        int frames = 0;
+        total += b.count_allocs("allocs/partial_tracker", 1000, 400, [&] {
+            if (frames++ % 14 == 0) // one hop every ~14 frames
+            {
+                events.clear();
+                analyzer.analyze(L.data() + off, R.data() + off, M.data() + off, off, events);
+                tracker.take(off, events);
+                tracker.track(events);
+            }
+            tracker.update(M.data() + off + N - tracker.window(), off + N - tracker.window());
+            off = (off + frame) % (L.size() - N);
+        });
+    }
+    return total;
+}
+
+void write_json(std::FILE *f, const Bench &b)
+{
+    std::fprintf(f, "{\n  \"version\": 1,\n  \"isa\": \"%s\",\n  \"results\": [\n", fft_isa_name(fft_detect_isa()));
+    for (size_t i = 0; i < b.results.size(); ++i)
+    {
+        const Result &r = b.results[i];
+        std::fprintf(f, "    {\"name\": \"%s\", \"ns_per_op\": %.3f, \"iters\": %llu", r.name.c_str(), r.ns_per_op,
+                     (unsigned long long)r.iters);
+        if (r.audio_sec > 0.0)
+            std::fprintf(f, ", \"audio_sec\": %.3f, \"x_realtime\": %.3f", r.audio_sec, r.x_realtime);
+        if (r.allocs >= 0)
+            std::fprintf(f, ", \"allocs\": %lld", (long long)r.allocs);
+        std::fprintf(f, "}%s\n", i + 1 < b.results.size() ? "," : "");
+    }
+    std::fprintf(f, "  ]\n}\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Bench b;
+    std::string json_path = "-";
+    std::string assets = "assets";
+    double synthetic_sec = 60.0;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--json" && i + 1 < argc)
+            json_path = argv[++i];
+        else if (arg == "--filter" && i + 1 < argc)
+            b.filter = argv[++i];
+        else if (arg == "--assets" && i + 1 < argc)
+            assets = argv[++i];
+        else if (arg == "--synthetic-sec" && i + 1 < argc)
+            synthetic_sec = std::atof(argv[++i]);
+        else if (arg == "--min-time" && i + 1 < argc)
+            b.min_time = std::atof(argv[++i]);
+        else
+        {
+            std::fprintf(stderr,
+                         "Usage: %s [--json out.json] [--filter substr] [--assets dir] [--synthetic-sec s] "
+                         "[--min-time s]\n",
+                         argv[0]);
+            return 1;
+        }
+    }
+
+    bench_kernels(b);
+    bench_assets(b, assets);
+    bench_synthetic(b, synthetic_sec);
+    bench_synthetic_multires(b, synthetic_sec);
+    uint64_t allocs = bench_allocations(b);
+
+    std::FILE *out = json_path == "-" ? stdout : std::fopen(json_path.c_str(), "w");
+    if (!out)
+    {
+        std::perror(json_path.c_str());
+        return 1;
+    }
+    write_json(out, b);
+    if (out != stdout)
+        std::fclose(out);
+    return allocs ? 2 : 0;
+}
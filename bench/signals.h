@@ -0,0 +1,77 @@
+#ifndef SIGNALS_H
+#define SIGNALS_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <numbers>
+
+// Deterministic synthetic stereo material for long benchmark runs.
+// Cycles through 5 s scenes: a log sweep, white noise panned by level, and a
+// chord with harmonics delayed on the right channel (non-zero ITD).
+// The same seed always produces the same samples.
+class SignalGenerator
+{
+public:
+    SignalGenerator(int rate, uint64_t seed = 1) : rate_(rate), state_(seed ? seed : 1) {}
+
+    void fill(float *L, float *R, size_t n)
+    {
+        const size_t scene_len = (size_t)rate_ * 5;
+        for (size_t i = 0; i < n; ++i, ++pos_)
+        {
+            size_t scene = (pos_ / scene_len) % 3;
+            double t = double(pos_ % scene_len) / rate_;
+            float l = 0.0f, r = 0.0f;
+            if (scene == 0)
+            {
+                // 50 Hz -> 8 kHz exponential sweep
+                const double f0 = 50.0, f1 = 8000.0, T = 5.0;
+                double k = std::log(f1 / f0) / T;
+                double phase = 2.0 * std::numbers::pi * f0 * (std::exp(k * t) - 1.0) / k;
+                l = r = 0.5f * float(std::sin(phase));
+            }
+            else if (scene == 1)
+            {
+                float v = 0.3f * noise();
+                l = v;
+                r = 0.5f * v; // louder on the left
+            }
+            else
+            {
+                // A major triad, 4 harmonics each, right channel 12 samples late
+                l = chord(t);
+                r = chord(t - 12.0 / rate_);
+            }
+            L[i] = l;
+            R[i] = r;
+        }
+    }
+
+private:
+    float noise()
+    {
+        // xorshift64*
+        state_ ^= state_ >> 12;
+        state_ ^= state_ << 25;
+        state_ ^= state_ >> 27;
+        uint64_t v = state_ * 2685821657736338717ull;
+        return float((v >> 40) * (1.0 / 16777216.0) * 2.0 - 1.0);
+    }
+
+    static float chord(double t)
+    {
+        const double roots[3] = {220.0, 277.18, 329.63};
+        double s = 0.0;
+        for (double f : roots)
+            for (int h = 1; h <= 4; ++h)
+                s += std::sin(2.0 * std::numbers::pi * f * h * t) / (h * 8.0);
+        return float(s);
+    }
+
+    int rate_;
+    uint64_t state_;
+    uint64_t pos_ = 0;
+};
+
+#endif
@@ -0,0 +1,213 @@
+#include <cmath>
+#include <algorithm>
+
+#include "analysis.h"
+#include "decoder.h"
+#include "helpers.h"
+#include "../stats.h"
+
+namespace
+{
+
+template <typename T>
+CircleEvent peak_to_circle(std::span<const T> mag_db, int bin, double db, int rate, int N, uint64_t sample,
+                           uint32_t span, std::span<double> timbre)
+{
+    double k_hat = interp_quadratic_bin(mag_db, bin);
+    double freq = (k_hat * rate) / double(N);
+
+    size_t harmonics;
+    {
+        SYN_TIME(Stage::Timbre);
+        harmonics = timbre_harmonics(mag_db, freq, rate, N, timbre);
+    }
+    return circle_from_timbre(freq, db, timbre.first(harmonics), sample, span);
+}
+
+} // namespace
+
+CircleEvent circle_from_peak(std::span<const double> mag_db, int bin, double db, int rate, int N,
+                             uint64_t sample, uint32_t span, std::span<double> timbre)
+{
+    return peak_to_circle(mag_db, bin, db, rate, N, sample, span, timbre);
+}
+
+CircleEvent circle_from_peak(std::span<const float> mag_db, int bin, double db, int rate, int N,
+                             uint64_t sample, uint32_t span, std::span<double> timbre)
+{
+    return peak_to_circle(mag_db, bin, db, rate, N, sample, span, timbre);
+}
+
+CircleEvent circle_from_timbre(double freq, double db, std::span<const double> timbre, uint64_t sample,
+                               uint32_t span)
+{
+    double fullness = fullness_timbre(timbre);
+
+    // Map freq 0..1000 Hz to y=0.1..0.9
+    float uy = 0.1f + 0.8f * freq / 1000.0f;
+    if (uy < 0.1f)
+        uy = 0.1f;
+    if (uy > 0.9f)
+        uy = 0.9f;
+    // Radius from number of harmonics
+    float radius = 0.03f + 0.07f * timbre.size() / 10.0f;
+    // Falloff from fullness (0.8..2.0)
+    float falloff = 0.8f + 1.2f * fullness;
+    // Intensity from overall level (0.5..1.5)
+    double level_db = db;
+    float intensity = 0.5f + 1.0f * float(std::min(std::max(level_db + 40.0, 0.0), 40.0) / 40.0);
+
+    CircleEvent e;
+    e.sample = sample;
+    e.x = falloff / 2;
+    e.y = uy;
+    e.radius = radius;
+    e.falloff = falloff;
+    e.intensity = intensity;
+    e.freq = float(freq);
+    e.db = float(db);
+    e.span = span;
+    return e;
+}
+
+AnalysisWorkspace::AnalysisWorkspace(const AnalysisParams &p)
+    : peaks(p.max_peaks), timbre(kMaxHarmonics)
+{
+    const int N = p.N;
+    if (p.single_precision)
+    {
+        hann_f.resize(N);
+        xw_f.resize(N);
+        X_f.resize(N / 2 + 1);
+        mag_db_f.resize(N / 2 + 1);
+        make_hann(hann_f);
+    }
+    else
+    {
+        hann.resize(N);
+        xw.resize(N);
+        X.resize(N / 2 + 1);
+        mag.resize(N / 2 + 1);
+        mag_db.resize(N / 2 + 1);
+        make_hann(hann);
+    }
+}
+
+HopAnalyzer::HopAnalyzer(int rate, const AnalysisParams &params)
+    : p_(params), rate_(rate), gcc_(params.N, rate), sums_(params.N, params.hop), ws_(params)
+{
+    if (p_.single_precision)
+        fft_f_ = std::make_unique<RealFftF>(params.N);
+    else
+        fft_ = std::make_unique<RealFft>(params.N);
+}
+
+// Window, FFT and dBFS of bins 0..N/2, all in float
+std::span<const float> HopAnalyzer::spectrum_f32(const float *Mw)
+{
+    const int N = p_.N;
+    {
+        SYN_TIME(Stage::Window);
+        for (int n = 0; n < N; ++n)
+            ws_.xw_f[n] = Mw[n] * ws_.hann_f[n];
+    }
+    {
+        SYN_TIME(Stage::Fft);
+        fft_f_->forward(ws_.xw_f.data(), ws_.X_f.data());
+    }
+    {
+        SYN_TIME(Stage::Magnitude);
+        magnitude_db(ws_.X_f.data(), ws_.X_f.size(), N * 0.5f, ws_.mag_db_f.data());
+    }
+    return ws_.mag_db_f;
+}
+
+std::span<const double> HopAnalyzer::spectrum_f64(const float *Mw)
+{
+    const int N = p_.N;
+    const int Nh = N / 2;
+
+    // Window Mid
+    {
+        SYN_TIME(Stage::Window);
+        for (int n = 0; n < N; ++n)
+        {
+            ws_.xw[n] = double(Mw[n]) * ws_.hann[n];
+        }
+    }
+
+    // FFT (real input, bins 0..N/2)
+    {
+        SYN_TIME(Stage::Fft);
+        fft_->forward(ws_.xw.data(), ws_.X.data());
+    }
+
+    {
+        SYN_TIME(Stage::Magnitude);
+        // Magnitude spectrum (only 0..N/2 are unique for real input)
+        for (int k = 0; k < Nh; ++k)
+        {
+            ws_.mag[k] = std::abs(ws_.X[k]) / (N * 0.5); // simple scale (approx)
+        }
+
+        // Convert to dBFS (reference 1.0 full-scale)
+        for (int k = 0; k < Nh; ++k)
+        {
+            ws_.mag_db[k] = 20.0 * std::log10(ws_.mag[k]);
+        }
+    }
+    return ws_.mag_db;
+}
+
+HopFeatures HopAnalyzer::analyze(const float *Lw, const float *Rw, const float *Mw, uint64_t sample,
+                                 std::vector<CircleEvent> &events)
+{
+    const int N = p_.N;
+    const int rate = rate_;
+
+    HopFeatures f{};
+    f.sample = sample;
+
+    {
+        SYN_TIME(Stage::Spatial);
+
+        // L, R, Mid and Side energies, from the HOP samples that entered the
+        // window when it continues the previous one
+        SpatialSums sums = sums_.update(Lw, Rw, sample);
+
+        // ILD
+        f.ild_db = db10(sums.R2 / sums.L2); // +Right, −Left
+
+        // ITD via GCC-PHAT
+        int maxLag = (int)std::round(p_.itd_max_sec * rate);
+        double lag = gcc_.lag(Lw, Rw, maxLag);
+        f.itd_sec = lag / (double)rate;
+
+        // Azimuth estimate via simple model (ILD+ITD)
+        f.azimuth_deg = azimuth_from_ild_itd(f.ild_db, f.itd_sec);
+
+        // Width via Mid/Side
+        f.width_db = sums.width_db();
+    }
+
+    // Peak pick: top peaks above the threshold
+    auto emit = [&](auto mag_db) {
+        size_t peaks;
+        {
+            SYN_TIME(Stage::Peaks);
+            peaks = peaks_selector(mag_db, p_.peak_thresh_db, std::span(ws_.peaks));
+        }
+        f.peaks = (int)peaks;
+
+        for (size_t i = 0; i < peaks; ++i)
+        {
+            auto [bin, db] = ws_.peaks[i];
+            events.push_back(circle_from_peak(mag_db, bin, db, rate, N, sample, (uint32_t)N, ws_.timbre));
+        }
+    };
+    if (p_.single_precision)
+        emit(spectrum_f32(Mw));
+    else
+        emit(spectrum_f64(Mw));
+    return f;
+}
@@ -0,0 +1,114 @@
+#ifndef ANALYSIS_H
+#define ANALYSIS_H
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "fourier.h"
+#include "spatial.h"
+
+// Defaults of the STFT analysis
+constexpr int kStftSize = 2 << 13;    // window (16384, ~340 ms at 48 kHz)
+constexpr int kStftOverlap = 4;       // windows covering each sample: hop = N / 4
+constexpr int kPeakThreshDb = -50;    // quietest peak that makes a circle, dBFS
+constexpr int kMaxPeaksPerHop = 3;
+
+// STFT analysis parameters
+struct AnalysisParams
+{
+    int N = kStftSize;                  // window size (power of 2)
+    int hop = kStftSize / kStftOverlap; // hop size (% overlap)
+    int peak_thresh_db = kPeakThreshDb; // peaks below this level are ignored
+    int max_peaks = kMaxPeaksPerHop;    // peaks kept per hop
+    double itd_max_sec = 0.001; // ITD search range (~1 ms)
+    bool single_precision = true; // float32 window/FFT/dB path; false for the double reference
+};
+
+// A circle produced by one spectral peak
+struct CircleEvent
+{
+    uint64_t sample; // first sample of the analysis window
+    float x, y;
+    float radius;
+    float falloff;
+    float intensity;
+    float freq;    // Hz
+    float db;      // peak level, dBFS
+    uint32_t span; // input samples covered by the analysis window
+};
+
+// Circle for a partial at freq Hz and level db with the given harmonic levels
+// (timbre_harmonics order); sample and span describe the analysis window
+CircleEvent circle_from_timbre(double freq, double db, std::span<const double> timbre, uint64_t sample,
+                               uint32_t span);
+
+// Circle for the peak at bin (level db) of a dB spectrum from an N-point FFT
+// at rate Hz; sample and span describe the window it came from. timbre is
+// scratch for the harmonic levels, kMaxHarmonics long.
+CircleEvent circle_from_peak(std::span<const double> mag_db, int bin, double db, int rate, int N,
+                             uint64_t sample, uint32_t span, std::span<double> timbre);
+CircleEvent circle_from_peak(std::span<const float> mag_db, int bin, double db, int rate, int N,
+                             uint64_t sample, uint32_t span, std::span<double> timbre);
+
+// Every buffer one analysis hop writes, sized once for a parameter set so a
+// hop in steady state never touches the heap. Only the spectrum buffers of
+// the selected precision are allocated. One per thread.
+struct AnalysisWorkspace
+{
+    explicit AnalysisWorkspace(const AnalysisParams &p);
+
+    // float32 path: window table, windowed Mid, bins 0..N/2 and their dBFS
+    std::vector<float> hann_f, xw_f, mag_db_f;
+    std::vector<cf> X_f;
+
+    // double reference path
+    std::vector<double> hann, xw, mag, mag_db;
+    std::vector<cd> X;
+
+    std::vector<std::pair<int, double>> peaks; // max_peaks slots
+    std::vector<double> timbre;                // kMaxHarmonics slots
+};
+
+// Spatial features of one hop
+struct HopFeatures
+{
+    uint64_t sample; // first sample of the analysis window
+    double ild_db;
+    double itd_sec;
+    double azimuth_deg;
+    double width_db;
+    int peaks;
+};
+
+// Everything audio_thread computes for one N-sample window: spatial cues from
+// L/R, spectrum of the Hann-windowed Mid, peaks, timbre and the circle mapping.
+// Owns its FFT plans and an AnalysisWorkspace; use one instance per thread.
+class HopAnalyzer
+{
+public:
+    HopAnalyzer(int rate, const AnalysisParams &params = {});
+
+    const AnalysisParams &params() const { return p_; }
+    int rate() const { return rate_; }
+
+    // L, R, M hold params().N samples; circle events are appended to events
+    HopFeatures analyze(const float *L, const float *R, const float *M, uint64_t sample,
+                        std::vector<CircleEvent> &events);
+
+private:
+    std::span<const float> spectrum_f32(const float *M);
+    std::span<const double> spectrum_f64(const float *M);
+
+    AnalysisParams p_;
+    int rate_;
+    GccPhat gcc_;
+    SpatialAccumulator sums_;
+    std::unique_ptr<RealFft> fft_;    // double path
+    std::unique_ptr<RealFftF> fft_f_; // float32 path
+    AnalysisWorkspace ws_;
+};
+
+#endif
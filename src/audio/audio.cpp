@@ -1,83 +1,146 @@
+#include <algorithm>
 #include <iostream>
 #include <vector>
 #include <cstdint>
-#include <sys/wait.h>
+#include <optional>
+#include <memory>
+#include <thread>
 
 #include "audio.h"
-#include "decoder.h"
+#include "analysis.h"
+#include "feature_cache.h"
 #include "helpers.h"
-#include "spatial.h"
-#include "fourier.h"
-#include "player.h"
+#include "input.h"
+#include "multires.h"
+#include "tracker.h"
+#include "playback.h"
+#include "ring_buffer.h"
 #include "../shared_state.h"
+#include "../stats.h"
 
 #define MINIMP3_IMPLEMENTATION
 #define MINIMP3_ONLY_MP3
 #include "../../external/minimp3/minimp3.h"
 #include "../../external/minimp3/minimp3_ex.h"
 
-inline void write_pcm_to_pipe(int pipefd[2], int16_t *pcm, int samples)
+void apply_analysis_options(AnalysisParams &p, const AudioOptions &opt)
 {
-    int channels = 2;
-    size_t bytes = (size_t)samples * channels * sizeof(int16_t);
-    const uint8_t *p = reinterpret_cast<const uint8_t *>(pcm);
-    while (bytes > 0)
+    p.single_precision = opt.single_precision;
+    if (opt.fft_size > 0)
     {
-        ssize_t n = write(pipefd[1], p, bytes);
-        if (n < 0)
-        {
-            perror("write to aplay");
-            break;
-        }
-        p += n;
-        bytes -= (size_t)n;
+        p.N = opt.fft_size;
+        p.hop = opt.fft_size / kStftOverlap;
     }
-    return;
 }
 
-void audio_thread(const std::string path, SharedState *shared)
+void audio_thread(const std::string path, SharedState *shared, AudioOptions opt)
 {
-    std::vector<uint8_t> audio_binary = read_binary(path);
+    std::optional<MappedFile> opened;
+    try
+    {
+        opened.emplace(path);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << '\n';
+        shared->running = false;
+        return;
+    }
+    MappedFile &input = *opened;
 
     mp3dec_t dec;
     mp3dec_init(&dec);
     mp3dec_frame_info_t info{};
-    int samples = mp3dec_decode_frame(&dec, audio_binary.data(), (int)(audio_binary.size()), nullptr, &info);
+    int samples = mp3dec_decode_frame(&dec, input.data(), (int)(input.size()), nullptr, &info);
+    const int rate = info.hz;
 
-    if (info.channels < 2)
+    std::unique_ptr<AudioSink> sink = make_audio_sink(opt.sink);
+    if (!sink || !sink->open(rate))
     {
-        std::cerr << "Only stereo files are supported\n";
+        std::cerr << "Cannot open audio sink: " << opt.sink << '\n';
+        shared->running = false;
+        return;
     }
-    const int rate = info.hz;
-
-    int pipefd[2] = {-1, -1};
-
-    pid_t aplay_pid = start_aplay_process(rate, pipefd);
+    shared->clock.start(rate);
+    Playback playback(*sink, rate, 0.5, &shared->clock);
 
     size_t pos = 0;
     size_t frame_idx = 0;
-    int16_t pcm[MINIMP3_MAX_SAMPLES_PER_FRAME]; // interleaved
-
-    std::vector<float> left_ring, right_ring;              // rolling stereo
-    std::vector<float> mid_ring;                           // Mid (used for STFT) rolling buffer
-    std::vector<float> left_frame(samples), right_frame(samples), mid_frame(samples); // per decoded frame
-
-    // STFT parameters
-    const int N = 2 << 13; // window size (power of 2)
-    const int HOP = N / 4; // hop size (% overlap)
-    std::vector<double> hann(N);
-    make_hann(hann);
-
-    int Nh = N / 2;
-    std::vector<cd> X(N);
-    std::vector<double> mag(Nh + 1);
-    std::vector<double> mag_db(Nh + 1);
+    int16_t pcm[MINIMP3_MAX_SAMPLES_PER_FRAME];    // interleaved, info.channels
+    int16_t stereo[MINIMP3_MAX_SAMPLES_PER_FRAME]; // mono frames doubled for the sink
+
+    AnalysisParams analysis_params;
+    apply_analysis_options(analysis_params, opt);
+    HopAnalyzer analyzer(rate, analysis_params);
+    const AnalysisParams &params = analyzer.params();
+    const int N = params.N;
+    const int HOP = params.hop;
+
+    // Cached features replace the analysis and the partial tracker; a missing
+    // or stale cache is rebuilt on a background thread while this run
+    // analyzes live.
+    std::unique_ptr<FeatureCache> cache;
+    std::thread cache_builder;
+    if (opt.use_cache && !opt.multires)
+    {
+        const bool track = opt.track_partials;
+        uint64_t hash = content_hash(input);
+        std::string cache_path = feature_cache_path(hash, params, track);
+        cache = FeatureCache::open(cache_path, hash, input.size(), params, track);
+        if (!cache)
+        {
+            cache_builder = std::thread([path, cache_path, hash, size = input.size(), params, track] {
+                if (!build_feature_cache(path, cache_path, hash, size, params, track))
+                    std::cerr << "Could not write feature cache: " << cache_path << '\n';
+            });
+        }
+    }
+    uint64_t decoded = 0;    // samples decoded so far
+    uint64_t next_event = 0; // next cached circle to emit
+    std::vector<CircleEvent> events;
+    uint64_t hop_sample = 0; // first sample of the next analysis window
+    const uint64_t centre = N / 2; // circles depict the middle of their analysis window
+
+    // A cached circle is due once the hop window centred on it has been
+    // decoded, exactly when the live path would have produced it
+    auto replay = [&](uint64_t decoded_to) {
+        const uint64_t *ev_sample = cache->samples(kEventSample);
+        const float *x = cache->floats(kEventX), *y = cache->floats(kEventY);
+        const float *radius = cache->floats(kEventRadius), *falloff = cache->floats(kEventFalloff);
+        const float *intensity = cache->floats(kEventIntensity);
+        for (; next_event < cache->events() && ev_sample[next_event] + (N - centre) <= decoded_to; ++next_event)
+            add_circle_shared(shared, x[next_event], y[next_event], radius[next_event], falloff[next_event],
+                              intensity[next_event], ev_sample[next_event]);
+    };
+    const uint64_t hop_budget_ns = (uint64_t)HOP * 1000000000ull / (uint64_t)rate; // realtime per hop
+
+    // Multi-resolution mode analyzes each decoded frame as it arrives
+    std::unique_ptr<MultiResAnalyzer> multires;
+    if (opt.multires)
+        multires = std::make_unique<MultiResAnalyzer>(rate);
+
+    // Between hops, the partials of the last hop are followed frame by frame
+    std::unique_ptr<PartialTracker> tracker;
+    std::vector<CircleEvent> restruck;
+    if (opt.track_partials && !opt.multires && !cache)
+        tracker = make_partial_tracker(rate, params);
+
+    // Rolling buffers: one full window plus one decoded frame, read N at a time
+    const size_t ring_cap = N + MINIMP3_MAX_SAMPLES_PER_FRAME;
+    SampleRing<float> left_ring(ring_cap, N), right_ring(ring_cap, N); // rolling stereo
+    SampleRing<float> mid_ring(ring_cap, N);                           // Mid (used for STFT)
+    std::vector<float> left_frame(MINIMP3_MAX_SAMPLES_PER_FRAME);      // per decoded frame
+    std::vector<float> right_frame(MINIMP3_MAX_SAMPLES_PER_FRAME);
+    std::vector<float> mid_frame(MINIMP3_MAX_SAMPLES_PER_FRAME);
 
     shared->running = true;
 
-    while (pos < audio_binary.size())
+    while (pos < input.size())
     {
-        samples = mp3dec_decode_frame(&dec, audio_binary.data() + pos, (int)(audio_binary.size() - pos), pcm, &info);
+        {
+            SYN_TIME(Stage::Decode);
+            samples = mp3dec_decode_frame(&dec, input.data() + pos, (int)(input.size() - pos), pcm, &info);
+        }
 
         // if (info.frame_bytes <= 0)
         // { // Not a valid frame here; advance minimally to resync
@@ -86,148 +149,102 @@ void audio_thread(const std::string path, SharedState *shared)
         //     continue;
         // }
         pos += info.frame_bytes;
+        input.release(pos);
 
-        for (int i = 0; i < samples; ++i)
+        decoded += samples;
+
+        // The sink plays interleaved stereo; a mono frame goes to both sides
+        const int16_t *out = pcm;
+        if (info.channels == 1)
         {
-            int16_t Ls = pcm[2 * i + 0];
-            int16_t Rs = pcm[2 * i + 1];
-            float L = float(Ls) / INT16_MAX_FLOAT;
-            float R = float(Rs) / INT16_MAX_FLOAT;
-
-            left_frame[i] = L;
-            right_frame[i] = R;
-            mid_frame[i] = 0.5f * (L + R); // Mid
+            for (int i = 0; i < samples; ++i)
+                stereo[2 * i] = stereo[2 * i + 1] = pcm[i];
+            out = stereo;
         }
 
-        // Append to rolling rings
-        left_ring.insert(left_ring.end(), left_frame.begin(), left_frame.end());
-        right_ring.insert(right_ring.end(), right_frame.begin(), right_frame.end());
-        mid_ring.insert(mid_ring.end(), mid_frame.begin(), mid_frame.end());
-
-        // Process as many STFT frames as we have (N every HOP)
-        int processed = 0;
-        while ((int)mid_ring.size() - processed >= N)
+        if (cache)
         {
-            const float *Lw = left_ring.data() + processed;
-            const float *Rw = right_ring.data() + processed;
-
-            // Energies
-            double L2, R2;
-            energy(Lw, Rw, N, &L2, &R2);
-
-            // ILD
-            double ILD_dB = db10((R2) / (L2)); // +Right, −Left
-
-            // ITD via cross-correlation
-            int maxLag = (int)std::round(0.001 * rate); // ~1 ms
-            int lag = xcorr_argmax_lag(Lw, Rw, N, maxLag);
-            double ITD_sec = (double)lag / (double)rate;
-
-            // Azimuth estimate via simple model (ILD+ITD)
-            double azimuth_deg = azimuth_from_ild_itd(ILD_dB, ITD_sec);
-
-            // Width via Mid/Side
-            double width_db = width_from_mid_side(Lw, Rw, N);
-
-            // Window Mid
-            for (int n = 0; n < N; ++n)
-            {
-                double xw = double(mid_ring[processed + n]) * hann[n];
-                X[n] = cd(xw, 0.0);
-            }
-
-            // FFT
-            fft_inplace(X);
-
-            // Magnitude spectrum (only 0..N/2 are unique for real input)
+            replay(decoded);
+            playback.write(out, samples);
+            frame_idx++;
+            continue;
+        }
 
-            for (int k = 0; k < Nh; ++k)
-            {
-                mag[k] = std::abs(X[k]) / (N * 0.5); // simple scale (approx)
-            }
+        split_stereo(pcm, samples, info.channels, left_frame.data(), right_frame.data(), mid_frame.data());
 
-            // Convert to dBFS (reference 1.0 full-scale)
-            for (int k = 0; k < Nh; ++k)
-            {
-                // double v = std::max(mag[k], 1e-12);
-                mag_db[k] = 20.0 * std::log10(mag[k]);
-            }
+        if (multires)
+        {
+            ScopedTimer hop_timer(Stage::Hop);
+            events.clear();
+            multires->push(left_frame.data(), right_frame.data(), mid_frame.data(), samples, events);
+            for (const CircleEvent &e : events)
+                add_circle_shared(shared, e.x, e.y, e.radius, e.falloff, e.intensity, e.sample + e.span / 2);
+            if (hop_timer.elapsed() > (uint64_t)samples * 1000000000ull / (uint64_t)rate)
+                stats().hops_behind_realtime.fetch_add(1, std::memory_order_relaxed);
+            playback.write(out, samples);
+            frame_idx++;
+            continue;
+        }
 
-            // Peak pick: top 10 peaks above -50 dB
-            auto peaks = peaks_selector(mag_db, -50, 3);
-            // std::cout << "Number of peaks found: " << peaks.size() << "\n";
+        // Append to rolling rings
+        left_ring.push(left_frame.data(), samples);
+        right_ring.push(right_frame.data(), samples);
+        mid_ring.push(mid_frame.data(), samples);
 
-            double fullness = 0.0;
-            for (auto &[bin, db] : peaks)
+        // Process as many STFT frames as we have (N every HOP)
+        while (mid_ring.size() >= (size_t)N)
+        {
+            ScopedTimer hop_timer(Stage::Hop);
+            events.clear();
+            analyzer.analyze(left_ring.peek(), right_ring.peek(), mid_ring.peek(), hop_sample, events);
+            if (tracker)
             {
-                double k_hat = interp_quadratic_bin(mag_db, bin);
-                double freq = (k_hat * rate) / double(N);
-
-                std::vector<double> timbre = timbre_harmonics(mag_db, freq, rate, N);
-
-                fullness = fullness_timbre(timbre);
-
-                // std::printf("   bin≈%.2f  freq≈%8.2f Hz   mag≈%6.1f dBFS", k_hat, freq, db);
-                // std::printf("  Fullness: %.2f\n", fullness);
-
-                // Add circle to shared state (if available)
-                if (shared)
-                {
-                    // Map azimuth -90..+90 to x=0.1..0.9
-                    float ux = 0.5f + 0.4f * float(azimuth_deg / 90.0);
-                    // Map width 0..20 dB to y=0.1..0.9
-                    float uy = 0.1f + 0.8f * freq / 1000.0f; // freq/1000Hz
-                    if (uy < 0.1f)
-                        uy = 0.1f;
-                    if (uy > 0.9f)
-                        uy = 0.9f;
-                    // Radius from fullness (0.0..0.5)
-                    float radius = 0.03f + 0.07f * timbre.size() / 10.0f;
-                    // Falloff from width (0.8..2.0)
-                    float falloff = 0.8f + 1.2f * fullness;
-                    // Intensity from overall level (0.5..1.5)
-                    double level_db = db;
-                    float intensity = 0.5f + 1.0f * float(std::min(std::max(level_db + 40.0, 0.0), 40.0) / 40.0);
-                    // std::cout << "  Circle: (" << ux << "," << uy << ") r=" << radius << " f=" << falloff << " I=" << intensity << "\n";
-                    add_circle_shared(shared, falloff / 2, uy, radius, falloff, intensity);
-                }
+                // Re-struck notes centred before this hop's window go first
+                restruck.clear();
+                tracker->take(hop_sample + centre, restruck);
+                for (const CircleEvent &e : restruck)
+                    add_circle_shared(shared, e.x, e.y, e.radius, e.falloff, e.intensity, e.sample + e.span / 2);
+                tracker->track(events);
             }
-
-            // Advance
-            processed += HOP;
-
-            // Drop consumed samples from rings (keep tail for overlap)
-            mid_ring.erase(mid_ring.begin(), mid_ring.begin() + processed);
-            left_ring.erase(left_ring.begin(), left_ring.begin() + processed);
-            right_ring.erase(right_ring.begin(), right_ring.begin() + processed);
+            for (const CircleEvent &e : events)
+                add_circle_shared(shared, e.x, e.y, e.radius, e.falloff, e.intensity, e.sample + e.span / 2);
+            if (hop_timer.elapsed() > hop_budget_ns)
+                stats().hops_behind_realtime.fetch_add(1, std::memory_order_relaxed);
+            hop_sample += HOP;
+
+            // Advance one hop (keep tail for overlap)
+            mid_ring.consume(HOP);
+            left_ring.consume(HOP);
+            right_ring.consume(HOP);
         }
 
-        // Drop consumed samples from ring buffer (keep tail for overlap)
-        if (processed > 0)
+        // Follow the tracked partials on the newest samples
+        if (tracker && mid_ring.size() >= (size_t)tracker->window())
         {
-            mid_ring.erase(mid_ring.begin(), mid_ring.begin() + processed);
+            size_t lead = mid_ring.size() - tracker->window();
+            tracker->update(mid_ring.peek() + lead, hop_sample + lead);
         }
 
-        // Write PCM to child (if launched)
-        write_pcm_to_pipe(pipefd, pcm, samples);
+        // Queue PCM for the playback thread
+        playback.write(out, samples);
 
         frame_idx++;
     }
+    if (cache)
+        replay(UINT64_MAX); // re-struck notes held past the last hop
+    events.clear();
+    if (tracker)
+        tracker->take(UINT64_MAX, events);
+    if (multires)
+        multires->flush(events);
+    for (const CircleEvent &e : events)
+        add_circle_shared(shared, e.x, e.y, e.radius, e.falloff, e.intensity, e.sample + e.span / 2);
+
+    // Play out what is queued and close the sink
+    playback.finish();
     shared->running = false;
 
-    // Close writer to signal EOF to aplay
-    if (pipefd[1] != -1)
-        close(pipefd[1]);
-
-    // Reap child
-    if (aplay_pid > 0)
-    {
-        int status = 0;
-        waitpid(aplay_pid, &status, 0);
-        if (WIFEXITED(status) && WEXITSTATUS(status) != 0)
-        {
-            std::fprintf(stderr, "aplay exited with status %d\n", WEXITSTATUS(status));
-        }
-    }
+    if (cache_builder.joinable())
+        cache_builder.join();
     return;
 }
\ No newline at end of file
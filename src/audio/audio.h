@@ -4,7 +4,24 @@
 #include <string>
 #include "../shared_state.h"
 
-void audio_thread(const std::string path, SharedState *shared);
+// Options of the realtime (playback) path
+struct AudioOptions
+{
+    bool use_cache = true;      // replay cached features when they match, build them otherwise
+    std::string sink = "aplay"; // see make_audio_sink()
+    bool multires = false;      // MultiResAnalyzer instead of the single long STFT (no cache)
+    bool track_partials = true; // PartialTracker between hops of the single STFT (cached with it)
+    bool single_precision = true; // AnalysisParams::single_precision
+    int fft_size = 0;             // AnalysisParams::N with a hop of N / kStftOverlap; 0 keeps the default
+};
+
+struct AnalysisParams;
+
+// The analysis choices of opt (precision, --fft-size) applied to p; every
+// mode that takes AnalysisParams goes through it, the live path included
+void apply_analysis_options(AnalysisParams &p, const AudioOptions &opt);
+
+void audio_thread(const std::string path, SharedState *shared, AudioOptions opt = {});
 
 #endif
 
@@ -0,0 +1,154 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <semaphore>
+#include <set>
+#include <thread>
+
+#include "batch.h"
+#include "offline.h"
+#include "scheduler.h"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+
+// s as one RFC 4180 field: quoted, embedded quotes doubled
+std::string csv_quote(const std::string &s)
+{
+    std::string q = "\"";
+    for (char c : s)
+    {
+        if (c == '"')
+            q += '"';
+        q += c;
+    }
+    return q + '"';
+}
+
+} // namespace
+
+std::vector<std::string> list_batch_inputs(const std::string &source)
+{
+    std::vector<std::string> files;
+    std::error_code ec;
+    if (fs::is_directory(source, ec))
+    {
+        for (const auto &e : fs::recursive_directory_iterator(source, fs::directory_options::skip_permission_denied, ec))
+        {
+            if (!e.is_regular_file())
+                continue;
+            std::string ext = e.path().extension().string();
+            std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+            if (ext == ".mp3")
+                files.push_back(e.path().string());
+        }
+        std::sort(files.begin(), files.end());
+        return files;
+    }
+
+    std::ifstream manifest(source);
+    if (!manifest)
+    {
+        std::cerr << "Cannot open: " << source << '\n';
+        return files;
+    }
+    std::string line;
+    while (std::getline(manifest, line))
+    {
+        while (!line.empty() && (line.back() == '\r' || line.back() == ' '))
+            line.pop_back();
+        if (line.empty() || line[0] == '#')
+            continue;
+        files.push_back(line);
+    }
+    return files;
+}
+
+int run_batch(const BatchOptions &opt)
+{
+    const auto t_start = std::chrono::steady_clock::now();
+
+    std::vector<std::string> files = list_batch_inputs(opt.source);
+    if (files.empty())
+    {
+        std::cerr << "No input files in: " << opt.source << '\n';
+        return 1;
+    }
+    std::error_code ec;
+    fs::create_directories(opt.out_dir, ec);
+
+    // Output names from the file stem, disambiguated when stems repeat
+    std::vector<std::string> outputs;
+    std::set<std::string> used;
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        std::string stem = fs::path(files[i]).stem().string();
+        std::string name = stem;
+        for (int k = 1; !used.insert(name).second; ++k)
+            name = stem + "_" + std::to_string(k);
+        outputs.push_back((fs::path(opt.out_dir) / (name + "." + opt.format)).string());
+    }
+
+    const int threads = opt.threads > 0 ? opt.threads : (int)std::max(1u, std::thread::hardware_concurrency());
+    const int max_inflight = opt.max_inflight > 0 ? opt.max_inflight : threads * 2;
+
+    std::vector<FileStats> stats(files.size());
+    std::vector<double> latency(files.size()); // submit to done
+    std::counting_semaphore<> slots(max_inflight);
+    uint64_t steals = 0;
+    {
+        WorkStealingPool pool(threads);
+        for (size_t i = 0; i < files.size(); ++i)
+        {
+            slots.acquire();
+            const auto submitted = std::chrono::steady_clock::now();
+            pool.submit([&, i, submitted] {
+                stats[i] = analyze_file(files[i], outputs[i], opt.params);
+                latency[i] = std::chrono::duration<double>(std::chrono::steady_clock::now() - submitted).count();
+                slots.release();
+            });
+        }
+        pool.wait_idle();
+        steals = pool.steals();
+    }
+    const double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count();
+
+    // Report: per file on stderr and in report.csv, then the totals
+    std::FILE *report = std::fopen((fs::path(opt.out_dir) / "report.csv").string().c_str(), "w");
+    if (report)
+        std::fprintf(report, "file,ok,audio_sec,analysis_sec,latency_sec,x_realtime,hops,circles\n");
+    int failed = 0;
+    double total_audio = 0.0;
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        const FileStats &s = stats[i];
+        double xrt = s.wall_sec > 0.0 ? s.audio_sec / s.wall_sec : 0.0;
+        if (!s.ok)
+            ++failed;
+        total_audio += s.audio_sec;
+        std::fprintf(stderr, "%-40s %s %8.1f s audio %7.2f s analysis %7.2f s latency %7.1fx\n",
+                     files[i].c_str(), s.ok ? "ok  " : "FAIL", s.audio_sec, s.wall_sec, latency[i], xrt);
+        if (report)
+            std::fprintf(report, "%s,%d,%.3f,%.4f,%.4f,%.2f,%llu,%llu\n", csv_quote(files[i]).c_str(), s.ok ? 1 : 0,
+                         s.audio_sec, s.wall_sec, latency[i], xrt, (unsigned long long)s.hops,
+                         (unsigned long long)s.events);
+    }
+    if (report)
+        std::fclose(report);
+
+    std::vector<double> sorted = latency;
+    std::sort(sorted.begin(), sorted.end());
+    auto pct = [&](double q) { return sorted[std::min(sorted.size() - 1, (size_t)(q * (sorted.size() - 1) + 0.5))]; };
+    std::fprintf(stderr,
+                 "%zu files (%d failed), %.1f s of audio in %.2f s wall: %.1fx realtime, %.2f files/s, %d threads, %llu steals\n"
+                 "latency p50 %.2f s, p95 %.2f s, max %.2f s\n",
+                 files.size(), failed, total_audio, wall, total_audio / std::max(wall, 1e-9),
+                 files.size() / std::max(wall, 1e-9), threads, (unsigned long long)steals,
+                 pct(0.5), pct(0.95), sorted.back());
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,27 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <string>
+#include <vector>
+
+#include "analysis.h"
+
+// Many files at once: each file is one task on a work-stealing pool, so
+// decode and analysis of different files overlap across cores.
+struct BatchOptions
+{
+    std::string source;          // directory (searched recursively for *.mp3) or manifest, one path per line
+    std::string out_dir;         // one feature file per input, plus report.csv
+    std::string format = "bin";  // "bin" or "csv"
+    int threads = 0;             // 0 = one per hardware thread
+    int max_inflight = 0;        // files open at once, 0 = 2 per thread
+    AnalysisParams params;
+};
+
+// Inputs named by a directory or manifest
+std::vector<std::string> list_batch_inputs(const std::string &source);
+
+// Returns a process exit code (non-zero if any file failed)
+int run_batch(const BatchOptions &opt);
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Audible position of the output stream in sample frames.
+//
+// The playback thread publishes an anchor after every sink write: the frame
+// being heard at that instant and how many frames the sink has been given.
+// Readers extrapolate from the anchor at the stream rate, never past what
+// was written, so a starved stream freezes instead of running ahead.
+// One writer, any number of readers (seqlock, no blocking on either side).
+class SampleClock
+{
+public:
+    static int64_t now_ns()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    void start(int rate) { rate_.store(rate, std::memory_order_release); }
+    int rate() const { return rate_.load(std::memory_order_acquire); }
+
+    // Writer: heard is audible at time ns, written frames reached the sink
+    void publish(uint64_t heard, uint64_t written, int64_t ns)
+    {
+        uint32_t s = seq_.load(std::memory_order_relaxed);
+        seq_.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        heard_.store(heard, std::memory_order_relaxed);
+        written_.store(written, std::memory_order_relaxed);
+        ns_.store(ns, std::memory_order_relaxed);
+        seq_.store(s + 2, std::memory_order_release);
+    }
+
+    // Frames audible at time ns (0 before the first anchor)
+    double position(int64_t ns) const
+    {
+        uint64_t heard, written;
+        int64_t t;
+        uint32_t s0, s1;
+        do
+        {
+            s0 = seq_.load(std::memory_order_acquire);
+            heard = heard_.load(std::memory_order_relaxed);
+            written = written_.load(std::memory_order_relaxed);
+            t = ns_.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            s1 = seq_.load(std::memory_order_relaxed);
+        } while (s0 != s1 || (s0 & 1));
+
+        int r = rate();
+        if (t == 0 || r <= 0)
+            return 0.0;
+        double pos = double(heard) + double(std::max<int64_t>(ns - t, 0)) * 1e-9 * r;
+        return std::min(pos, double(written));
+    }
+
+private:
+    std::atomic<int> rate_{0};
+    std::atomic<uint32_t> seq_{0};
+    std::atomic<uint64_t> heard_{0};
+    std::atomic<uint64_t> written_{0};
+    std::atomic<int64_t> ns_{0};
+};
+
+#endif
@@ -1,59 +1,62 @@
 #include <cmath>
 #include <algorithm>
 #include "fourier.h"
+#include "decoder.h"
 
-// Hann window
-void make_hann(std::vector<double>& w) {
+// Bodies shared by the double and float overloads
+namespace {
+
+// Hann window, computed in double
+template <typename W>
+void hann_into(W& w) {
     const size_t N = w.size();
     for (size_t n = 0; n < N; ++n) {
         w[n] = 0.5 * (1.0 - std::cos(2.0 * std::numbers::pi * n / (N - 1)));
     }
 }
 
-std::vector<std::pair<int,double>> peaks_selector(const std::vector<double>& mag, int thresh, int max_peaks){
-    std::vector<std::pair<int,double>> peaks;
+// Local maxima above thresh (greater than the two bins below, at least the two
+// above), keeping the out.size() loudest by insertion, loudest first
+template <typename Mag>
+size_t select_peaks(const Mag& mag, int thresh, std::span<std::pair<int,double>> out) {
+    const size_t cap = out.size();
+    size_t n = 0;
+    if (cap == 0) return 0;
     const int N = (int)mag.size();
-    for (int i = 1; i < N - 1; ++i) {
+    for (int i = 2; i < N - 2; ++i) {
         if (mag[i] > thresh) {
             if (mag[i] > mag[i-2] && mag[i] > mag[i-1] && mag[i] >= mag[i+1] && mag[i] >= mag[i+2]) {
-                peaks.emplace_back(i, mag[i]);
+                double v = mag[i];
+                if (n == cap && v <= out[n-1].second) continue;
+                size_t j = n < cap ? n++ : n - 1;
+                for (; j > 0 && out[j-1].second < v; --j) out[j] = out[j-1];
+                out[j] = {i, v};
             }
         }
     }
-    std::partial_sort(peaks.begin(), peaks.begin() + std::min(max_peaks, (int)peaks.size()), peaks.end(),
-                      [](auto& a, auto& b){ return a.second > b.second; });
-    if ((int)peaks.size() > max_peaks) peaks.resize(max_peaks);
-    return peaks;
+    return n;
 }
 
-std::vector<double> timbre_harmonics(const std::vector<double>& mag_db, double fundamental_freq, int sample_rate, int N) {
-    std::vector<double> timbre;
+template <typename Mag>
+size_t harmonics_of(const Mag& mag_db, double fundamental_freq, int sample_rate, int N, std::span<double> out) {
+    size_t n = 0;
     int h = 1;
-    while (timbre.empty() || (h <= 100 && timbre[h - 1] > -100.0)) {
+    while (n < out.size() && (n == 0 || (h <= kMaxHarmonics && out[n-1] > kSilenceDb))) {
         double target = h * fundamental_freq;
-        int harmonic_bin = int(target / (sample_rate / N) + 0.5); // nearest bin
+        int harmonic_bin = int(target / (double(sample_rate) / N) + 0.5); // nearest bin
         if (harmonic_bin < (int)mag_db.size()) {
-            double amp = mag_db[harmonic_bin];
-            timbre.push_back(amp);
+            out[n++] = mag_db[harmonic_bin];
         } else {
-            timbre.push_back(-100.0); // treat as silence if out of range
+            out[n++] = kSilenceDb; // treat as silence if out of range
         }
         h++;
     }
-    return timbre;
-}
-
-float fullness_timbre(const std::vector<double>& timbre) {
-    double fullness = 0.0;
-    for (size_t i = 1; i < timbre.size(); ++i) {
-        fullness += timbre[i] + 120.0;
-    }
-    fullness /= double(timbre.size() * 120.0);
-    return float(fullness);
+    return n;
 }
 
 // Optional quadratic interpolation around peaks for sub-bin freq estimate
-double interp_quadratic_bin(const std::vector<double>& mag, int k) {
+template <typename Mag>
+double interp_bin(const Mag& mag, int k) {
     if (k <= 0 || k >= (int)mag.size()-1) return (double)k;
     double m1 = mag[k-1], m0 = mag[k], p1 = mag[k+1];
     double denom = (m1 - 2*m0 + p1);
@@ -61,3 +64,58 @@ double interp_quadratic_bin(const std::vector<double>& mag, int k) {
     double delta = 0.5 * (m1 - p1) / denom; // shift in bins, (-0.5..0.5)
     return (double)k + delta;
 }
+
+} // namespace
+
+void make_hann(std::vector<double>& w) { hann_into(w); }
+void make_hann(std::span<float> w) { hann_into(w); }
+
+size_t peaks_selector(std::span<const double> mag, int thresh, std::span<std::pair<int,double>> out) {
+    return select_peaks(mag, thresh, out);
+}
+size_t peaks_selector(std::span<const float> mag, int thresh, std::span<std::pair<int,double>> out) {
+    return select_peaks(mag, thresh, out);
+}
+
+std::vector<std::pair<int,double>> peaks_selector(const std::vector<double>& mag, int thresh, int max_peaks) {
+    std::vector<std::pair<int,double>> peaks(std::max(max_peaks, 0));
+    peaks.resize(select_peaks(mag, thresh, std::span(peaks)));
+    return peaks;
+}
+std::vector<std::pair<int,double>> peaks_selector(std::span<const float> mag, int thresh, int max_peaks) {
+    std::vector<std::pair<int,double>> peaks(std::max(max_peaks, 0));
+    peaks.resize(select_peaks(mag, thresh, std::span(peaks)));
+    return peaks;
+}
+
+size_t timbre_harmonics(std::span<const double> mag_db, double fundamental_freq, int sample_rate, int N,
+                        std::span<double> out) {
+    return harmonics_of(mag_db, fundamental_freq, sample_rate, N, out);
+}
+size_t timbre_harmonics(std::span<const float> mag_db, double fundamental_freq, int sample_rate, int N,
+                        std::span<double> out) {
+    return harmonics_of(mag_db, fundamental_freq, sample_rate, N, out);
+}
+
+std::vector<double> timbre_harmonics(const std::vector<double>& mag_db, double fundamental_freq, int sample_rate, int N) {
+    std::vector<double> timbre(kMaxHarmonics);
+    timbre.resize(harmonics_of(mag_db, fundamental_freq, sample_rate, N, std::span(timbre)));
+    return timbre;
+}
+std::vector<double> timbre_harmonics(std::span<const float> mag_db, double fundamental_freq, int sample_rate, int N) {
+    std::vector<double> timbre(kMaxHarmonics);
+    timbre.resize(harmonics_of(mag_db, fundamental_freq, sample_rate, N, std::span(timbre)));
+    return timbre;
+}
+
+double interp_quadratic_bin(std::span<const double> mag, int k) { return interp_bin(mag, k); }
+double interp_quadratic_bin(std::span<const float> mag, int k) { return interp_bin(mag, k); }
+
+float fullness_timbre(std::span<const double> timbre) {
+    double fullness = 0.0;
+    for (size_t i = 1; i < timbre.size(); ++i) {
+        fullness += timbre[i] + 120.0;
+    }
+    fullness /= double(timbre.size() * 120.0);
+    return float(fullness);
+}
@@ -1,17 +1,42 @@
 #ifndef DECODER_H
 #define DECODER_H
 
+#include <span>
+#include <utility>
 #include <vector>
 
+// timbre_harmonics() stops at the 100th harmonic
+constexpr int kMaxHarmonics = 100;
+// ... or after the first harmonic at or below this level, dBFS; harmonics
+// above Nyquist read as this level
+constexpr double kSilenceDb = -100.0;
+
 void make_hann(std::vector<double>& w);
 
 std::vector<std::pair<int,double>> peaks_selector(const std::vector<double>& mag, int thresh, int max_peaks);
 
 std::vector<double> timbre_harmonics(const std::vector<double>& mag_db, double fundamental_freq, int sample_rate, int N);
 
-float fullness_timbre(const std::vector<double>& timbre);
+float fullness_timbre(std::span<const double> timbre);
 
 // Optional quadratic interpolation around peaks for sub-bin freq estimate
-double interp_quadratic_bin(const std::vector<double>& mag, int k);
+double interp_quadratic_bin(std::span<const double> mag, int k);
+
+// Single-precision spectrum overloads; same results up to float rounding
+void make_hann(std::span<float> w);
+std::vector<std::pair<int,double>> peaks_selector(std::span<const float> mag, int thresh, int max_peaks);
+std::vector<double> timbre_harmonics(std::span<const float> mag_db, double fundamental_freq, int sample_rate, int N);
+double interp_quadratic_bin(std::span<const float> mag, int k);
+
+// Allocation-free forms for the hop loop: results go to caller-owned storage
+// and the count written is returned. peaks_selector keeps the out.size()
+// loudest peaks, loudest first; timbre_harmonics needs kMaxHarmonics slots to
+// match the vector form.
+size_t peaks_selector(std::span<const double> mag, int thresh, std::span<std::pair<int,double>> out);
+size_t peaks_selector(std::span<const float> mag, int thresh, std::span<std::pair<int,double>> out);
+size_t timbre_harmonics(std::span<const double> mag_db, double fundamental_freq, int sample_rate, int N,
+                        std::span<double> out);
+size_t timbre_harmonics(std::span<const float> mag_db, double fundamental_freq, int sample_rate, int N,
+                        std::span<double> out);
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,247 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <bit>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <vector>
+
+#include "feature_cache.h"
+#include "offline.h"
+#include "../stats.h"
+
+namespace
+{
+
+const uint64_t kFnvOffset = 1469598103934665603ull;
+const uint64_t kFnvPrime = 1099511628211ull;
+
+uint64_t fnv1a(uint64_t h, const void *data, size_t n)
+{
+    const uint8_t *p = static_cast<const uint8_t *>(data);
+    for (size_t i = 0; i < n; ++i)
+        h = (h ^ p[i]) * kFnvPrime;
+    return h;
+}
+
+uint64_t params_hash(const AnalysisParams &p, bool track_partials)
+{
+    uint64_t h = kFnvOffset;
+    h = fnv1a(h, &p.N, sizeof(p.N));
+    h = fnv1a(h, &p.hop, sizeof(p.hop));
+    h = fnv1a(h, &p.peak_thresh_db, sizeof(p.peak_thresh_db));
+    h = fnv1a(h, &p.max_peaks, sizeof(p.max_peaks));
+    h = fnv1a(h, &p.itd_max_sec, sizeof(p.itd_max_sec));
+    h = fnv1a(h, &p.single_precision, sizeof(p.single_precision));
+    h = fnv1a(h, &track_partials, sizeof(track_partials));
+    return h;
+}
+
+bool params_match(const FeatureCacheHeader &h, const AnalysisParams &p, bool track_partials)
+{
+    return h.N == p.N && h.hop == p.hop && h.peak_thresh_db == p.peak_thresh_db &&
+           h.max_peaks == p.max_peaks && h.itd_max_sec == p.itd_max_sec &&
+           h.single_precision == (uint32_t)p.single_precision && h.track_partials == (uint32_t)track_partials;
+}
+
+size_t align64(size_t n) { return (n + 63) & ~size_t(63); }
+
+// Collects analyze_stream output column by column; circles are keyed by the
+// centre of their window, so hop and re-struck circles share one timeline
+struct ColumnSink : HopSink
+{
+    int rate = 0;
+    std::vector<uint64_t> hop_sample, event_sample;
+    std::vector<float> ild, itd, azimuth, width;
+    std::vector<float> x, y, radius, falloff, intensity, freq, db;
+
+    bool begin(int r) override
+    {
+        rate = r;
+        return true;
+    }
+
+    void hop(const HopFeatures &f, const CircleEvent *events, uint32_t count) override
+    {
+        hop_sample.push_back(f.sample);
+        ild.push_back(float(f.ild_db));
+        itd.push_back(float(f.itd_sec));
+        azimuth.push_back(float(f.azimuth_deg));
+        width.push_back(float(f.width_db));
+        add_events(events, count);
+    }
+
+    void tail(const CircleEvent *events, uint32_t count) override { add_events(events, count); }
+
+    void add_events(const CircleEvent *events, uint32_t count)
+    {
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            const CircleEvent &e = events[i];
+            event_sample.push_back(e.sample + e.span / 2);
+            x.push_back(e.x);
+            y.push_back(e.y);
+            radius.push_back(e.radius);
+            falloff.push_back(e.falloff);
+            intensity.push_back(e.intensity);
+            freq.push_back(e.freq);
+            db.push_back(e.db);
+        }
+    }
+};
+
+} // namespace
+
+uint64_t content_hash(const MappedFile &input)
+{
+    // Four independent multiply-rotate lanes over 8-byte words (the rounds of
+    // xxHash64), so the whole file hashes at memory speed, then FNV-1a over
+    // the lanes, the tail bytes and the size
+    const uint64_t kP1 = 0x9E3779B185EBCA87ull, kP2 = 0xC2B2AE3D27D4EB4Full;
+    auto round = [&](uint64_t acc, uint64_t w) { return std::rotl(acc + w * kP2, 31) * kP1; };
+    const uint8_t *d = input.data();
+    const size_t n = input.size();
+
+    uint64_t lane[4] = {kP1 + kP2, kP2, 0, 0 - kP1};
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32)
+        for (int k = 0; k < 4; ++k)
+        {
+            uint64_t w;
+            std::memcpy(&w, d + i + 8 * k, 8);
+            lane[k] = round(lane[k], w);
+        }
+    uint64_t h = fnv1a(kFnvOffset, lane, sizeof(lane));
+    h = fnv1a(h, d + i, n - i);
+    return fnv1a(h, &n, sizeof(n));
+}
+
+std::string feature_cache_path(uint64_t content_hash, const AnalysisParams &p, bool track_partials)
+{
+    namespace fs = std::filesystem;
+    fs::path dir;
+    if (const char *xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg)
+        dir = fs::path(xdg) / "synesthesia";
+    else if (const char *home = std::getenv("HOME"); home && *home)
+        dir = fs::path(home) / ".cache" / "synesthesia";
+    else
+        dir = fs::temp_directory_path() / "synesthesia";
+
+    char name[64];
+    std::snprintf(name, sizeof(name), "%016llx-%016llx.feat", (unsigned long long)content_hash,
+                  (unsigned long long)params_hash(p, track_partials));
+    return (dir / name).string();
+}
+
+std::unique_ptr<FeatureCache> FeatureCache::open(const std::string &path, uint64_t content_hash,
+                                                 uint64_t file_size, const AnalysisParams &p,
+                                                 bool track_partials)
+{
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return nullptr;
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(FeatureCacheHeader))
+    {
+        close(fd);
+        return nullptr;
+    }
+    void *m = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (m == MAP_FAILED)
+        return nullptr;
+
+    std::unique_ptr<FeatureCache> c(new FeatureCache());
+    c->base_ = static_cast<const uint8_t *>(m);
+    c->size_ = (size_t)st.st_size;
+    c->h_ = reinterpret_cast<const FeatureCacheHeader *>(c->base_);
+
+    const FeatureCacheHeader &h = *c->h_;
+    if (std::memcmp(h.magic, "SYNFEAT", 8) != 0 || h.version != kFeatureCacheVersion ||
+        h.content_hash != content_hash || h.file_size != file_size ||
+        !params_match(h, p, track_partials))
+        return nullptr;
+    for (int col = 0; col < kFeatureColumns; ++col)
+    {
+        uint64_t count = col < kEventSample ? h.hops : h.events;
+        size_t elem = (col == kHopSample || col == kEventSample) ? sizeof(uint64_t) : sizeof(float);
+        if (h.column[col] % 64 != 0 || h.column[col] + count * elem > c->size_)
+            return nullptr;
+    }
+    madvise(m, c->size_, MADV_SEQUENTIAL);
+    return c;
+}
+
+FeatureCache::~FeatureCache()
+{
+    if (base_)
+        munmap(const_cast<uint8_t *>(base_), size_);
+}
+
+bool build_feature_cache(const std::string &input, const std::string &cache_path, uint64_t content_hash,
+                         uint64_t file_size, const AnalysisParams &p, bool track_partials)
+{
+    StatsMute mute; // runs beside the live path; its hops are not realtime
+    ColumnSink cols;
+    FileStats st = analyze_stream(input, p, cols, track_partials);
+    if (!st.ok)
+        return false;
+
+    FeatureCacheHeader h{};
+    std::memcpy(h.magic, "SYNFEAT", 8);
+    h.version = kFeatureCacheVersion;
+    h.rate = (uint32_t)cols.rate;
+    h.content_hash = content_hash;
+    h.file_size = file_size;
+    h.N = p.N;
+    h.hop = p.hop;
+    h.peak_thresh_db = p.peak_thresh_db;
+    h.max_peaks = p.max_peaks;
+    h.itd_max_sec = p.itd_max_sec;
+    h.single_precision = p.single_precision;
+    h.track_partials = track_partials;
+    h.hops = cols.hop_sample.size();
+    h.events = cols.event_sample.size();
+
+    const void *data[kFeatureColumns] = {
+        cols.hop_sample.data(), cols.ild.data(), cols.itd.data(), cols.azimuth.data(), cols.width.data(),
+        cols.event_sample.data(), cols.x.data(), cols.y.data(), cols.radius.data(), cols.falloff.data(),
+        cols.intensity.data(), cols.freq.data(), cols.db.data()};
+    size_t bytes[kFeatureColumns];
+    size_t off = align64(sizeof(h));
+    for (int col = 0; col < kFeatureColumns; ++col)
+    {
+        uint64_t count = col < kEventSample ? h.hops : h.events;
+        size_t elem = (col == kHopSample || col == kEventSample) ? sizeof(uint64_t) : sizeof(float);
+        bytes[col] = count * elem;
+        h.column[col] = off;
+        off = align64(off + bytes[col]);
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(cache_path).parent_path(), ec);
+    const std::string tmp = cache_path + ".tmp" + std::to_string(getpid());
+    std::FILE *f = std::fopen(tmp.c_str(), "wb");
+    if (!f)
+        return false;
+    static const uint8_t zeros[64] = {};
+    size_t written = std::fwrite(&h, sizeof(h), 1, f) == 1 ? sizeof(h) : 0;
+    bool ok = written == sizeof(h);
+    for (int col = 0; ok && col < kFeatureColumns; ++col)
+    {
+        ok = std::fwrite(zeros, 1, h.column[col] - written, f) == h.column[col] - written &&
+             std::fwrite(data[col], 1, bytes[col], f) == bytes[col];
+        written = h.column[col] + bytes[col];
+    }
+    ok = std::fclose(f) == 0 && ok;
+    if (!ok || std::rename(tmp.c_str(), cache_path.c_str()) != 0)
+    {
+        std::remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
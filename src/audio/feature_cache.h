@@ -0,0 +1,99 @@
+#ifndef FEATURE_CACHE_H
+#define FEATURE_CACHE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "analysis.h"
+#include "input.h"
+
+// On-disk, columnar copy of everything HopAnalyzer (and, when enabled, the
+// PartialTracker between hops) produced for one file. Replays mmap it and
+// read circles straight from the columns instead of running the STFT again. The file name is keyed by content hash and
+// analysis parameters; the header repeats both so a stale, truncated or
+// foreign file is detected and rebuilt.
+
+const uint32_t kFeatureCacheVersion = 4;
+
+enum FeatureColumn
+{
+    // one entry per hop
+    kHopSample, // uint64_t
+    kHopIld,    // float, dB
+    kHopItd,    // float, seconds
+    kHopAzimuth,
+    kHopWidth,
+    // one entry per circle event
+    kEventSample, // uint64_t, centre of the circle's analysis window (where it is shown)
+    kEventX,      // float
+    kEventY,
+    kEventRadius,
+    kEventFalloff,
+    kEventIntensity,
+    kEventFreq,
+    kEventDb,
+    kFeatureColumns
+};
+
+struct FeatureCacheHeader
+{
+    char magic[8]; // "SYNFEAT"
+    uint32_t version;
+    uint32_t rate;
+    uint64_t content_hash;
+    uint64_t file_size;
+    // analysis parameters the columns were computed with
+    int32_t N, hop, peak_thresh_db, max_peaks;
+    double itd_max_sec;
+    uint32_t single_precision;
+    uint32_t track_partials; // re-struck circles included
+    uint64_t hops;
+    uint64_t events;
+    uint64_t column[kFeatureColumns]; // byte offset of each column, 64-byte aligned
+};
+
+// Hash of every byte of the file and its size, so any edit changes the key
+// (about 1 ms for a 4 MB MP3 in the page cache)
+uint64_t content_hash(const MappedFile &input);
+
+// $XDG_CACHE_HOME/synesthesia (or ~/.cache/synesthesia)/<content>-<params>.feat
+std::string feature_cache_path(uint64_t content_hash, const AnalysisParams &p, bool track_partials);
+
+class FeatureCache
+{
+public:
+    // nullptr when the file is missing or does not match hash and parameters
+    static std::unique_ptr<FeatureCache> open(const std::string &path, uint64_t content_hash,
+                                              uint64_t file_size, const AnalysisParams &p, bool track_partials);
+    ~FeatureCache();
+
+    FeatureCache(const FeatureCache &) = delete;
+    FeatureCache &operator=(const FeatureCache &) = delete;
+
+    const FeatureCacheHeader &header() const { return *h_; }
+    uint64_t hops() const { return h_->hops; }
+    uint64_t events() const { return h_->events; }
+
+    const uint64_t *samples(FeatureColumn c) const
+    {
+        return reinterpret_cast<const uint64_t *>(base_ + h_->column[c]);
+    }
+    const float *floats(FeatureColumn c) const
+    {
+        return reinterpret_cast<const float *>(base_ + h_->column[c]);
+    }
+
+private:
+    FeatureCache() = default;
+
+    const uint8_t *base_ = nullptr;
+    size_t size_ = 0;
+    const FeatureCacheHeader *h_ = nullptr;
+};
+
+// Analyze input and write its cache (temporary file, then rename)
+bool build_feature_cache(const std::string &input, const std::string &cache_path, uint64_t content_hash,
+                         uint64_t file_size, const AnalysisParams &p, bool track_partials);
+
+#endif
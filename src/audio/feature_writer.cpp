@@ -0,0 +1,55 @@
+#include <cstring>
+
+#include "feature_writer.h"
+
+FeatureWriter::FeatureWriter(const std::string &path, int rate, const AnalysisParams &p)
+    : rate_(rate)
+{
+    csv_ = path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0;
+    f_ = path == "-" ? stdout : std::fopen(path.c_str(), csv_ ? "w" : "wb");
+    if (!f_)
+        return;
+    if (csv_)
+    {
+        std::fprintf(f_, "# hop,sample,time,ild_db,itd_sec,azimuth_deg,width_db,peaks\n");
+        std::fprintf(f_, "# circle,sample,time,x,y,radius,falloff,intensity,freq,db\n");
+    }
+    else
+    {
+        OfflineHeader h{};
+        std::memcpy(h.magic, "SYNO", 4);
+        h.version = kOfflineVersion;
+        h.rate = (uint32_t)rate;
+        h.N = (uint32_t)p.N;
+        h.hop = (uint32_t)p.hop;
+        std::fwrite(&h, sizeof(h), 1, f_);
+    }
+}
+
+FeatureWriter::~FeatureWriter()
+{
+    if (f_ && f_ != stdout)
+        std::fclose(f_);
+}
+
+void FeatureWriter::write(const HopFeatures &f, const CircleEvent *events, uint32_t count)
+{
+    if (csv_)
+    {
+        double t = double(f.sample) / rate_;
+        std::fprintf(f_, "hop,%llu,%.6f,%.4f,%.8f,%.4f,%.4f,%d\n",
+                     (unsigned long long)f.sample, t, f.ild_db, f.itd_sec, f.azimuth_deg, f.width_db, f.peaks);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            const CircleEvent &c = events[i];
+            std::fprintf(f_, "circle,%llu,%.6f,%.5f,%.5f,%.5f,%.5f,%.5f,%.3f,%.3f\n",
+                         (unsigned long long)c.sample, t, c.x, c.y, c.radius, c.falloff, c.intensity, c.freq, c.db);
+        }
+    }
+    else
+    {
+        std::fwrite(&f, sizeof(f), 1, f_);
+        std::fwrite(&count, sizeof(count), 1, f_);
+        std::fwrite(events, sizeof(CircleEvent), count, f_);
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef FEATURE_WRITER_H
+#define FEATURE_WRITER_H
+
+#include <cstdio>
+#include <string>
+
+#include "analysis.h"
+
+// Writes per-hop features and their circle events, in the order given.
+// Text when the path ends in .csv, binary otherwise, "-" for stdout.
+//
+// Binary layout (host endianness):
+//   OfflineHeader, then per hop: HopFeatures, uint32_t count, CircleEvent[count]
+struct OfflineHeader
+{
+    char magic[4]; // "SYNO"
+    uint32_t version;
+    uint32_t rate;
+    uint32_t N;
+    uint32_t hop;
+};
+
+const uint32_t kOfflineVersion = 2;
+
+class FeatureWriter
+{
+public:
+    FeatureWriter(const std::string &path, int rate, const AnalysisParams &p);
+    ~FeatureWriter();
+
+    FeatureWriter(const FeatureWriter &) = delete;
+    FeatureWriter &operator=(const FeatureWriter &) = delete;
+
+    bool ok() const { return f_ != nullptr; }
+
+    void write(const HopFeatures &f, const CircleEvent *events, uint32_t count);
+
+private:
+    std::FILE *f_ = nullptr;
+    bool csv_ = false;
+    int rate_;
+};
+
+#endif
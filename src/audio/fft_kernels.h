@@ -0,0 +1,249 @@
+#ifndef FFT_KERNELS_H
+#define FFT_KERNELS_H
+
+// Split real/imaginary FFT butterflies, shared by the per-ISA translation units.
+// Each fourier_<isa>.cpp includes this header, is compiled with its own -m flags
+// and instantiates fft_split_stages<> with its vector type. Everything here lives
+// in an anonymous namespace so the per-ISA copies never get merged by the linker.
+//
+// Input is expected in bit-reversed order. Twiddles for the radix-2 stage with
+// half-length m are stored at [m-1, 2m-1): w[m-1+k] = exp(-i*pi*k/m).
+// Two radix-2 stages (m, 2m) are fused into one radix-4 pass, so the data is
+// walked log4(n) times instead of log2(n).
+//
+// The kernels are templates on the vector type, whose `scalar` is double or
+// float; each TU exports both precisions, plus the magnitude-to-dB and the
+// channel covariance loops compiled for its ISA.
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+using FftStagesFn = void (*)(double *re, double *im, size_t n, const double *wr, const double *wi);
+using FftStagesFnF = void (*)(float *re, float *im, size_t n, const float *wr, const float *wi);
+using MagnitudeDbFn = void (*)(const float *X, size_t bins, float offset_db, float *db);
+using ChannelCovarianceFn = void (*)(const float *x, int channels, size_t frames, double *cov, float *planar);
+
+constexpr int kMaxChannels = 16; // channel_covariance_loop tile height
+
+void fft_split_stages_scalar(double *re, double *im, size_t n, const double *wr, const double *wi);
+void fft_split_stages_f32_scalar(float *re, float *im, size_t n, const float *wr, const float *wi);
+void magnitude_db_scalar(const float *X, size_t bins, float offset_db, float *db);
+void channel_covariance_scalar(const float *x, int channels, size_t frames, double *cov, float *planar);
+#if defined(SYN_FFT_X86)
+void fft_split_stages_sse2(double *re, double *im, size_t n, const double *wr, const double *wi);
+void fft_split_stages_avx2(double *re, double *im, size_t n, const double *wr, const double *wi);
+void fft_split_stages_avx512(double *re, double *im, size_t n, const double *wr, const double *wi);
+void fft_split_stages_f32_sse2(float *re, float *im, size_t n, const float *wr, const float *wi);
+void fft_split_stages_f32_avx2(float *re, float *im, size_t n, const float *wr, const float *wi);
+void fft_split_stages_f32_avx512(float *re, float *im, size_t n, const float *wr, const float *wi);
+void magnitude_db_sse2(const float *X, size_t bins, float offset_db, float *db);
+void magnitude_db_avx2(const float *X, size_t bins, float offset_db, float *db);
+void magnitude_db_avx512(const float *X, size_t bins, float offset_db, float *db);
+void channel_covariance_sse2(const float *x, int channels, size_t frames, double *cov, float *planar);
+void channel_covariance_avx2(const float *x, int channels, size_t frames, double *cov, float *planar);
+void channel_covariance_avx512(const float *x, int channels, size_t frames, double *cov, float *planar);
+#endif
+
+namespace
+{
+
+template <typename T>
+struct ScalarVec
+{
+    using scalar = T;
+    using reg = T;
+    static constexpr size_t width = 1;
+    static reg load(const T *p) { return *p; }
+    static void store(T *p, reg v) { *p = v; }
+    static reg add(reg a, reg b) { return a + b; }
+    static reg sub(reg a, reg b) { return a - b; }
+    static reg mul(reg a, reg b) { return a * b; }
+};
+
+// One fused radix-4 pass (stages m and 2m) over every 4m block
+template <class V, typename S = typename V::scalar>
+inline void fft_radix4_pass(S *re, S *im, size_t n, size_t m,
+                            const S *w1r, const S *w1i,
+                            const S *w2r, const S *w2i)
+{
+    using R = typename V::reg;
+    for (size_t i = 0; i < n; i += 4 * m)
+    {
+        S *r0 = re + i, *r1 = r0 + m, *r2 = r1 + m, *r3 = r2 + m;
+        S *i0 = im + i, *i1 = i0 + m, *i2 = i1 + m, *i3 = i2 + m;
+        for (size_t k = 0; k < m; k += V::width)
+        {
+            R ar = V::load(w1r + k), ai = V::load(w1i + k);
+            R br = V::load(w2r + k), bi = V::load(w2i + k);
+
+            R x0r = V::load(r0 + k), x0i = V::load(i0 + k);
+            R x1r = V::load(r1 + k), x1i = V::load(i1 + k);
+            R x2r = V::load(r2 + k), x2i = V::load(i2 + k);
+            R x3r = V::load(r3 + k), x3i = V::load(i3 + k);
+
+            // stage m: t = w1 * x1, x3
+            R t1r = V::sub(V::mul(x1r, ar), V::mul(x1i, ai));
+            R t1i = V::add(V::mul(x1r, ai), V::mul(x1i, ar));
+            R t3r = V::sub(V::mul(x3r, ar), V::mul(x3i, ai));
+            R t3i = V::add(V::mul(x3r, ai), V::mul(x3i, ar));
+
+            R a0r = V::add(x0r, t1r), a0i = V::add(x0i, t1i);
+            R a1r = V::sub(x0r, t1r), a1i = V::sub(x0i, t1i);
+            R a2r = V::add(x2r, t3r), a2i = V::add(x2i, t3i);
+            R a3r = V::sub(x2r, t3r), a3i = V::sub(x2i, t3i);
+
+            // stage 2m: twiddle w2 for (a0, a2), -i * w2 for (a1, a3)
+            R u2r = V::sub(V::mul(a2r, br), V::mul(a2i, bi));
+            R u2i = V::add(V::mul(a2r, bi), V::mul(a2i, br));
+            R u3r = V::sub(V::mul(a3r, br), V::mul(a3i, bi));
+            R u3i = V::add(V::mul(a3r, bi), V::mul(a3i, br));
+
+            V::store(r0 + k, V::add(a0r, u2r));
+            V::store(i0 + k, V::add(a0i, u2i));
+            V::store(r2 + k, V::sub(a0r, u2r));
+            V::store(i2 + k, V::sub(a0i, u2i));
+            V::store(r1 + k, V::add(a1r, u3i));
+            V::store(i1 + k, V::sub(a1i, u3r));
+            V::store(r3 + k, V::sub(a1r, u3i));
+            V::store(i3 + k, V::add(a1i, u3r));
+        }
+    }
+}
+
+// Single radix-2 pass, used for the last stage when log2(n) is odd
+template <class V, typename S = typename V::scalar>
+inline void fft_radix2_pass(S *re, S *im, size_t n, size_t m,
+                            const S *wr, const S *wi)
+{
+    using R = typename V::reg;
+    for (size_t i = 0; i < n; i += 2 * m)
+    {
+        S *r0 = re + i, *r1 = r0 + m;
+        S *i0 = im + i, *i1 = i0 + m;
+        for (size_t k = 0; k < m; k += V::width)
+        {
+            R w_r = V::load(wr + k), w_i = V::load(wi + k);
+            R x0r = V::load(r0 + k), x0i = V::load(i0 + k);
+            R x1r = V::load(r1 + k), x1i = V::load(i1 + k);
+            R tr = V::sub(V::mul(x1r, w_r), V::mul(x1i, w_i));
+            R ti = V::add(V::mul(x1r, w_i), V::mul(x1i, w_r));
+            V::store(r0 + k, V::add(x0r, tr));
+            V::store(i0 + k, V::add(x0i, ti));
+            V::store(r1 + k, V::sub(x0r, tr));
+            V::store(i1 + k, V::sub(x0i, ti));
+        }
+    }
+}
+
+// All butterfly stages; passes narrower than the vector fall back to scalar
+template <class V, typename S = typename V::scalar>
+inline void fft_split_stages(S *re, S *im, size_t n, const S *wr, const S *wi)
+{
+    size_t m = 1;
+    for (; 4 * m <= n; m *= 4)
+    {
+        const S *w1r = wr + (m - 1), *w1i = wi + (m - 1);
+        const S *w2r = wr + (2 * m - 1), *w2i = wi + (2 * m - 1);
+        if (m >= V::width)
+            fft_radix4_pass<V>(re, im, n, m, w1r, w1i, w2r, w2i);
+        else
+            fft_radix4_pass<ScalarVec<S>>(re, im, n, m, w1r, w1i, w2r, w2i);
+    }
+    if (m < n)
+    {
+        if (m >= V::width)
+            fft_radix2_pass<V>(re, im, n, m, wr + (m - 1), wi + (m - 1));
+        else
+            fft_radix2_pass<ScalarVec<S>>(re, im, n, m, wr + (m - 1), wi + (m - 1));
+    }
+}
+
+// log2(x) for normal x > 0 without libm. x = 2^e * m with m in [sqrt(1/2), sqrt(2));
+// log2(m) = t * P(t), t = m - 1, P a degree-4 least-squares fit on Chebyshev
+// nodes. The error bound of the resulting dB values is stated, as measured,
+// at magnitude_db() in fourier.h.
+// Written with plain integer/float ops so every TU auto-vectorizes it at its width.
+inline float fast_log2(float x)
+{
+    int32_t bits = std::bit_cast<int32_t>(x);
+    int32_t e = (bits - 0x3f3504f3) >> 23; // exponent, rounded so m stays around 1
+    float t = std::bit_cast<float>(bits - (e << 23)) - 1.0f;
+    float p = 0.24239271f;
+    p = p * t - 0.39246483f;
+    p = p * t + 0.48822640f;
+    p = p * t - 0.72040099f;
+    p = p * t + 1.44252159f;
+    return float(e) + t * p;
+}
+
+// db[k] = 10 log10(re^2 + im^2) + offset_db for interleaved complex X.
+// FLT_MIN is added to the power so zero and subnormal bins stay in fast_log2's
+// domain without a branch (about -379 dB instead of -inf).
+inline void magnitude_db_loop(const float *X, size_t bins, float offset_db, float *db)
+{
+    const float kDbPerLog2 = 3.01029996f; // 10 log10(2)
+    for (size_t k = 0; k < bins; ++k)
+    {
+        float re = X[2 * k], im = X[2 * k + 1];
+        float p = re * re + im * im + 1.17549435e-38f;
+        db[k] = kDbPerLog2 * fast_log2(p) + offset_db;
+    }
+}
+
+// cov[i * channels + j] += sum over frames of x_i * x_j, for every pair
+// i <= j of the interleaved x (channels <= kMaxChannels; the lower triangle
+// is not touched). One pass: each block of 64 frames is transposed into a
+// channel-major tile that stays in L1, optionally copied out to planar
+// (channel c at planar + c * frames), and every pair is then a fixed-length
+// dot product in 8 float lanes. The lanes are added into per-pair double
+// lanes once per block and reduced only at the end, so no block pays for a
+// horizontal sum.
+inline void channel_covariance_loop(const float *x, int channels, size_t frames, double *cov, float *planar)
+{
+    constexpr int kBlock = 64, kLanes = 8;
+    alignas(64) float tile[kMaxChannels][kBlock];
+    alignas(64) double lanes[kMaxChannels * (kMaxChannels + 1) / 2][kLanes] = {};
+    for (size_t n0 = 0; n0 < frames; n0 += kBlock)
+    {
+        const int nb = int(frames - n0 < kBlock ? frames - n0 : kBlock);
+        const float *blk = x + n0 * channels;
+        // Channel-outer: strided reads, but each tile row is written in order
+        for (int c = 0; c < channels; ++c)
+        {
+            for (int k = 0; k < nb; ++k)
+                tile[c][k] = blk[k * channels + c];
+            for (int k = nb; k < kBlock; ++k)
+                tile[c][k] = 0.0f;
+            if (planar)
+                for (int k = 0; k < nb; ++k)
+                    planar[c * frames + n0 + k] = tile[c][k];
+        }
+
+        double *d = lanes[0];
+        for (int i = 0; i < channels; ++i)
+            for (int j = i; j < channels; ++j, d += kLanes)
+            {
+                float acc[kLanes] = {};
+                for (int k = 0; k < kBlock; k += kLanes)
+                    for (int l = 0; l < kLanes; ++l)
+                        acc[l] += tile[i][k + l] * tile[j][k + l];
+                for (int l = 0; l < kLanes; ++l)
+                    d[l] += acc[l];
+            }
+    }
+
+    const double *d = lanes[0];
+    for (int i = 0; i < channels; ++i)
+        for (int j = i; j < channels; ++j, d += kLanes)
+        {
+            double sum = 0.0;
+            for (int l = 0; l < kLanes; ++l)
+                sum += d[l];
+            cov[i * channels + j] += sum;
+        }
+}
+
+} // namespace
+
+#endif
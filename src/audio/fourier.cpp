@@ -1,7 +1,21 @@
 #include <cmath>
+#include <numbers>
 #include "fourier.h"
+#include "fft_kernels.h"
 
-// In-place iterative radix-2 FFT (a.size() MUST be power of 2)
+#if defined(SYN_FFT_X86)
+#include <cpuid.h>
+
+// XCR0 via xgetbv; the intrinsic would need -mxsave for this whole TU
+static unsigned long long read_xcr0() {
+    unsigned lo, hi;
+    __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return ((unsigned long long)hi << 32) | lo;
+}
+#endif
+
+// In-place iterative radix-2 FFT (a.size() MUST be power of 2).
+// Kept as the scalar reference the planned/vectorized paths are checked against.
 void fft_inplace(std::vector<cd>& a) {
     const size_t n = a.size();
     // bit-reverse permutation
@@ -27,4 +41,207 @@ void fft_inplace(std::vector<cd>& a) {
             }
         }
     }
-}
\ No newline at end of file
+}
+
+FftIsa fft_detect_isa() {
+    static const FftIsa isa = [] {
+#if defined(SYN_FFT_X86)
+        unsigned eax, ebx, ecx, edx;
+        if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return FftIsa::Scalar;
+        if (!(edx & bit_SSE2)) return FftIsa::Scalar;
+        // AVX state must also be enabled by the OS (OSXSAVE + XCR0)
+        bool osxsave = ecx & bit_OSXSAVE;
+        bool avx = ecx & bit_AVX;
+        unsigned long long xcr0 = osxsave ? read_xcr0() : 0;
+        bool ymm = (xcr0 & 0x6) == 0x6;
+        bool zmm = (xcr0 & 0xe6) == 0xe6;
+        unsigned eax7 = 0, ebx7 = 0, ecx7 = 0, edx7 = 0;
+        __get_cpuid_count(7, 0, &eax7, &ebx7, &ecx7, &edx7);
+        if (avx && zmm && (ebx7 & bit_AVX512F)) return FftIsa::Avx512;
+        if (avx && ymm && (ebx7 & bit_AVX2)) return FftIsa::Avx2;
+        return FftIsa::Sse2;
+#else
+        return FftIsa::Scalar;
+#endif
+    }();
+    return isa;
+}
+
+const char* fft_isa_name(FftIsa isa) {
+    switch (isa) {
+    case FftIsa::Sse2: return "sse2";
+    case FftIsa::Avx2: return "avx2";
+    case FftIsa::Avx512: return "avx512";
+    default: return "scalar";
+    }
+}
+
+void fft_split_stages_scalar(double* re, double* im, size_t n, const double* wr, const double* wi) {
+    fft_split_stages<ScalarVec<double>>(re, im, n, wr, wi);
+}
+
+void fft_split_stages_f32_scalar(float* re, float* im, size_t n, const float* wr, const float* wi) {
+    fft_split_stages<ScalarVec<float>>(re, im, n, wr, wi);
+}
+
+void magnitude_db_scalar(const float* X, size_t bins, float offset_db, float* db) {
+    magnitude_db_loop(X, bins, offset_db, db);
+}
+
+static FftStagesFn select_stages(FftIsa isa, double*) {
+#if defined(SYN_FFT_X86)
+    switch (isa) {
+    case FftIsa::Sse2: return fft_split_stages_sse2;
+    case FftIsa::Avx2: return fft_split_stages_avx2;
+    case FftIsa::Avx512: return fft_split_stages_avx512;
+    default: break;
+    }
+#endif
+    (void)isa;
+    return fft_split_stages_scalar;
+}
+
+static FftStagesFnF select_stages(FftIsa isa, float*) {
+#if defined(SYN_FFT_X86)
+    switch (isa) {
+    case FftIsa::Sse2: return fft_split_stages_f32_sse2;
+    case FftIsa::Avx2: return fft_split_stages_f32_avx2;
+    case FftIsa::Avx512: return fft_split_stages_f32_avx512;
+    default: break;
+    }
+#endif
+    (void)isa;
+    return fft_split_stages_f32_scalar;
+}
+
+static MagnitudeDbFn select_magnitude_db(FftIsa isa) {
+#if defined(SYN_FFT_X86)
+    switch (isa) {
+    case FftIsa::Sse2: return magnitude_db_sse2;
+    case FftIsa::Avx2: return magnitude_db_avx2;
+    case FftIsa::Avx512: return magnitude_db_avx512;
+    default: break;
+    }
+#endif
+    (void)isa;
+    return magnitude_db_scalar;
+}
+
+template <typename T>
+BasicFftPlan<T>::BasicFftPlan(size_t n, FftIsa isa)
+    : n_(n), isa_(isa), stages_(select_stages(isa, (T*)nullptr)), rev_(n),
+      twr_(n > 1 ? n - 1 : 0), twi_(n > 1 ? n - 1 : 0), re_(n), im_(n) {
+    int bits = 0;
+    while ((size_t(1) << bits) < n) ++bits;
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t r = 0;
+        for (int b = 0; b < bits; ++b)
+            if (i & (size_t(1) << b)) r |= uint32_t(1) << (bits - 1 - b);
+        rev_[i] = r;
+    }
+    for (size_t m = 1; m < n; m <<= 1) {
+        for (size_t k = 0; k < m; ++k) {
+            double ang = -std::numbers::pi * double(k) / double(m);
+            twr_[m - 1 + k] = T(std::cos(ang));
+            twi_[m - 1 + k] = T(std::sin(ang));
+        }
+    }
+}
+
+template <typename T>
+void BasicFftPlan<T>::execute(complex_type* a) {
+    for (size_t i = 0; i < n_; ++i) {
+        size_t j = rev_[i];
+        re_[j] = a[i].real();
+        im_[j] = a[i].imag();
+    }
+    execute_split(re_.data(), im_.data());
+    for (size_t i = 0; i < n_; ++i)
+        a[i] = complex_type(re_[i], im_[i]);
+}
+
+template <typename T>
+void BasicFftPlan<T>::execute_split(T* re, T* im) const {
+    if (n_ > 1) stages_(re, im, n_, twr_.data(), twi_.data());
+}
+
+template <typename T>
+BasicRealFft<T>::BasicRealFft(size_t n, FftIsa isa)
+    : n_(n), half_(n / 2, isa), post_(n / 4 + 1), re_(n / 2), im_(n / 2) {
+    for (size_t k = 0; k < post_.size(); ++k) {
+        double ang = -2.0 * std::numbers::pi * double(k) / double(n);
+        post_[k] = complex_type(T(std::cos(ang)), T(std::sin(ang)));
+    }
+}
+
+template <typename T>
+void BasicRealFft<T>::forward(const T* in, complex_type* out) {
+    using C = complex_type;
+    const size_t h = n_ / 2;
+    const uint32_t* rev = half_.bitrev();
+    T* zr = re_.data();
+    T* zi = im_.data();
+    // z[k] = x[2k] + i x[2k+1], scattered straight into bit-reversed order
+    for (size_t k = 0; k < h; ++k) {
+        zr[rev[k]] = in[2 * k];
+        zi[rev[k]] = in[2 * k + 1];
+    }
+
+    half_.execute_split(zr, zi);
+
+    // X[k] = E[k] + W^k O[k], with E/O the spectra of even/odd samples:
+    // E[k] = (Z[k] + conj(Z[h-k])) / 2, O[k] = (Z[k] - conj(Z[h-k])) / 2i
+    out[0] = C(zr[0] + zi[0], T(0));
+    out[h] = C(zr[0] - zi[0], T(0));
+    for (size_t k = 1; k <= h / 2; ++k) {
+        C a(zr[k], zi[k]);
+        C b(zr[h - k], -zi[h - k]);
+        C e = T(0.5) * (a + b);
+        C o = C(T(0), T(-0.5)) * (a - b);
+        // W^(h-k) = -conj(W^k)
+        C wk = post_[k];
+        out[k]     = e + wk * o;
+        out[h - k] = std::conj(e - wk * o);
+    }
+}
+
+template <typename T>
+void BasicRealFft<T>::inverse(const complex_type* in, T* out) {
+    using C = complex_type;
+    const size_t h = n_ / 2;
+    const uint32_t* rev = half_.bitrev();
+    T* zr = re_.data();
+    T* zi = im_.data();
+    // Undo the post-pass: Z[k] = E[k] + i O[k], with
+    // E[k] = (X[k] + conj(X[h-k])) / 2, O[k] = (X[k] - conj(X[h-k])) conj(W^k) / 2.
+    // The inverse runs as conj(FFT(conj(Z))), so conj(Z) is stored.
+    for (size_t k = 0; k < h; ++k) {
+        C a = in[k];
+        C b = std::conj(in[h - k]);
+        C wk = k <= h / 2 ? post_[k] : -std::conj(post_[h - k]);
+        C e = T(0.5) * (a + b);
+        C o = T(0.5) * (a - b) * std::conj(wk);
+        C z = e + C(T(0), T(1)) * o;
+        zr[rev[k]] = z.real();
+        zi[rev[k]] = -z.imag();
+    }
+
+    half_.execute_split(zr, zi);
+
+    const T scale = T(1) / T(h);
+    for (size_t k = 0; k < h; ++k) {
+        out[2 * k]     = zr[k] * scale;
+        out[2 * k + 1] = -zi[k] * scale;
+    }
+}
+
+template class BasicFftPlan<double>;
+template class BasicFftPlan<float>;
+template class BasicRealFft<double>;
+template class BasicRealFft<float>;
+
+void magnitude_db(const cf* X, size_t bins, float ref, float* db, FftIsa isa) {
+    // |X|^2 / ref^2 in dB: the ref term is a constant offset
+    const float offset_db = float(-20.0 * std::log10(double(ref)));
+    select_magnitude_db(isa)(reinterpret_cast<const float*>(X), bins, offset_db, db);
+}
@@ -0,0 +1,51 @@
+#include <immintrin.h>
+#include "fft_kernels.h"
+
+namespace
+{
+
+struct Avx512Vec
+{
+    using scalar = double;
+    using reg = __m512d;
+    static constexpr size_t width = 8;
+    static reg load(const double *p) { return _mm512_loadu_pd(p); }
+    static void store(double *p, reg v) { _mm512_storeu_pd(p, v); }
+    static reg add(reg a, reg b) { return _mm512_add_pd(a, b); }
+    static reg sub(reg a, reg b) { return _mm512_sub_pd(a, b); }
+    static reg mul(reg a, reg b) { return _mm512_mul_pd(a, b); }
+};
+
+struct Avx512VecF
+{
+    using scalar = float;
+    using reg = __m512;
+    static constexpr size_t width = 16;
+    static reg load(const float *p) { return _mm512_loadu_ps(p); }
+    static void store(float *p, reg v) { _mm512_storeu_ps(p, v); }
+    static reg add(reg a, reg b) { return _mm512_add_ps(a, b); }
+    static reg sub(reg a, reg b) { return _mm512_sub_ps(a, b); }
+    static reg mul(reg a, reg b) { return _mm512_mul_ps(a, b); }
+};
+
+} // namespace
+
+void fft_split_stages_avx512(double *re, double *im, size_t n, const double *wr, const double *wi)
+{
+    fft_split_stages<Avx512Vec>(re, im, n, wr, wi);
+}
+
+void fft_split_stages_f32_avx512(float *re, float *im, size_t n, const float *wr, const float *wi)
+{
+    fft_split_stages<Avx512VecF>(re, im, n, wr, wi);
+}
+
+void magnitude_db_avx512(const float *X, size_t bins, float offset_db, float *db)
+{
+    magnitude_db_loop(X, bins, offset_db, db);
+}
+
+void channel_covariance_avx512(const float *x, int channels, size_t frames, double *cov, float *planar)
+{
+    channel_covariance_loop(x, channels, frames, cov, planar);
+}
@@ -0,0 +1,51 @@
+#include <emmintrin.h>
+#include "fft_kernels.h"
+
+namespace
+{
+
+struct Sse2Vec
+{
+    using scalar = double;
+    using reg = __m128d;
+    static constexpr size_t width = 2;
+    static reg load(const double *p) { return _mm_loadu_pd(p); }
+    static void store(double *p, reg v) { _mm_storeu_pd(p, v); }
+    static reg add(reg a, reg b) { return _mm_add_pd(a, b); }
+    static reg sub(reg a, reg b) { return _mm_sub_pd(a, b); }
+    static reg mul(reg a, reg b) { return _mm_mul_pd(a, b); }
+};
+
+struct Sse2VecF
+{
+    using scalar = float;
+    using reg = __m128;
+    static constexpr size_t width = 4;
+    static reg load(const float *p) { return _mm_loadu_ps(p); }
+    static void store(float *p, reg v) { _mm_storeu_ps(p, v); }
+    static reg add(reg a, reg b) { return _mm_add_ps(a, b); }
+    static reg sub(reg a, reg b) { return _mm_sub_ps(a, b); }
+    static reg mul(reg a, reg b) { return _mm_mul_ps(a, b); }
+};
+
+} // namespace
+
+void fft_split_stages_sse2(double *re, double *im, size_t n, const double *wr, const double *wi)
+{
+    fft_split_stages<Sse2Vec>(re, im, n, wr, wi);
+}
+
+void fft_split_stages_f32_sse2(float *re, float *im, size_t n, const float *wr, const float *wi)
+{
+    fft_split_stages<Sse2VecF>(re, im, n, wr, wi);
+}
+
+void magnitude_db_sse2(const float *X, size_t bins, float offset_db, float *db)
+{
+    magnitude_db_loop(X, bins, offset_db, db);
+}
+
+void channel_covariance_sse2(const float *x, int channels, size_t frames, double *cov, float *planar)
+{
+    channel_covariance_loop(x, channels, frames, cov, planar);
+}
@@ -10,7 +10,7 @@
 
 #define INT16_MAX_FLOAT 32768.0f // 2^15
 
-std::vector<uint8_t> read_binary(const std::string &path)
+inline std::vector<uint8_t> read_binary(const std::string &path)
 {
     std::ifstream f(path, std::ios::binary);
     if (!f)
@@ -25,6 +25,19 @@ std::vector<uint8_t> read_binary(const std::string &path)
     return data;
 }
 
+// Decoded int16 frame to float L/R/Mid; mono input is duplicated to both sides
+inline void split_stereo(const int16_t *pcm, int samples, int channels, float *L, float *R, float *M)
+{
+    for (int i = 0; i < samples; ++i)
+    {
+        float l = float(pcm[channels * i]) / INT16_MAX_FLOAT;
+        float r = channels > 1 ? float(pcm[channels * i + 1]) / INT16_MAX_FLOAT : l;
+        L[i] = l;
+        R[i] = r;
+        M[i] = 0.5f * (l + r); // Mid
+    }
+}
+
 inline double db10(double x)
 {
     return 10.0 * std::log10(std::max(x, 1e-20));
@@ -0,0 +1,67 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <stdexcept>
+#include <fstream>
+#include <iterator>
+
+#include "input.h"
+
+// Dropping pages one frame at a time would cost a syscall per frame
+static const size_t kReleaseChunk = 1 << 20;
+
+MappedFile::MappedFile(const std::string &path)
+{
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        throw std::runtime_error("Cannot open: " + path);
+
+    struct stat st{};
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+    {
+        void *p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED)
+        {
+            madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);
+            data_ = static_cast<const uint8_t *>(p);
+            size_ = (size_t)st.st_size;
+            mapped_ = true;
+        }
+    }
+    close(fd);
+
+    if (!mapped_)
+    {
+        std::ifstream f(path, std::ios::binary);
+        if (!f)
+            throw std::runtime_error("Cannot open: " + path);
+        fallback_.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+        data_ = fallback_.data();
+        size_ = fallback_.size();
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    if (mapped_)
+        munmap(const_cast<uint8_t *>(data_), size_);
+}
+
+void MappedFile::release(size_t pos)
+{
+    if (!mapped_ || pos < released_ + kReleaseChunk)
+        return;
+    const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t end = pos / page * page;
+    madvise(const_cast<uint8_t *>(data_) + released_, end - released_, MADV_DONTNEED);
+    released_ = end;
+}
+
+std::string resolve_input_path(const std::string &arg)
+{
+    if (access(arg.c_str(), R_OK) == 0)
+        return arg;
+    return "assets/" + arg;
+}
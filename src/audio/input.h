@@ -0,0 +1,41 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Read-only view of an input file (MP3 stream, WAV).
+// The file is mmap'd with MADV_SEQUENTIAL so the kernel reads ahead as the
+// decoder walks forward, and nothing is read before the first frame is
+// decoded. release() hands already-decoded pages back, keeping the resident
+// size constant whatever the file length. Files that cannot be mapped
+// (pipes, special files) fall back to a plain read.
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string &path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const uint8_t *data() const { return data_; }
+    size_t size() const { return size_; }
+
+    // Bytes before pos will not be read again
+    void release(size_t pos);
+
+private:
+    const uint8_t *data_ = nullptr;
+    size_t size_ = 0;
+    bool mapped_ = false;
+    size_t released_ = 0;
+    std::vector<uint8_t> fallback_;
+};
+
+// Path as given if it exists, otherwise looked up under assets/
+std::string resolve_input_path(const std::string &arg);
+
+#endif
@@ -0,0 +1,263 @@
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+
+#include "mp3_index.h"
+#include "feature_cache.h"
+#include "scheduler.h"
+
+#include "../../external/minimp3/minimp3.h"
+
+namespace
+{
+
+const uint32_t kMp3IndexVersion = 1;
+
+struct Mp3IndexHeader
+{
+    char magic[8]; // "SYNIDX"
+    uint32_t version;
+    uint32_t rate;
+    uint64_t content_hash;
+    uint64_t file_size;
+    uint64_t frames;
+};
+
+static_assert(sizeof(Mp3Frame) == 32, "Mp3Frame is stored as is");
+
+// Layer III main data a frame can lend to later ones, and a lower bound of
+// what each frame carries: its length less header, CRC and the largest
+// side info (MPEG-1 stereo)
+constexpr size_t kReservoirBytes = 511;
+constexpr size_t kFrameOverhead = 4 + 2 + 32;
+
+// Frames decoded in full (reservoir included) ahead of the first one wanted
+constexpr size_t kFullWarmupFrames = 2;
+
+// Put a fresh decoder in the sync state a sequential pass has after frame
+// prev: its header to match the next one against, and the frame length of a
+// free-format stream. Without it the decoder resyncs at the first frame,
+// which needs a run of valid frames ahead and so fails near damage the
+// sequential pass went through.
+void prime_sync(mp3dec_t &dec, const uint8_t *data, const Mp3Frame &prev)
+{
+    const uint8_t *h = data + prev.offset;
+    std::memset(&dec, 0, sizeof(dec)); // what a resync leaves, reservoir and history empty
+    std::memcpy(dec.header, h, sizeof(dec.header));
+    if ((h[2] & 0xF0) == 0) // free format: the length comes from the last resync
+    {
+        const int padding = (h[2] & 0x2) ? ((h[1] & 6) == 6 ? 4 : 1) : 0; // layer I pads in slots
+        dec.free_format_bytes = (int)prev.bytes - padding;
+    }
+}
+
+} // namespace
+
+Mp3Index Mp3Index::build(const uint8_t *data, size_t size)
+{
+    Mp3Index idx;
+    mp3dec_t dec;
+    mp3dec_init(&dec);
+    uint64_t sample = 0, pcm = 0;
+    size_t pos = 0;
+    // Same walk as the decode loops, with pcm = nullptr: minimp3 then only
+    // syncs and parses headers. `reserv` is not touched on that path, except
+    // by the reset that precedes a resync, which this sentinel detects.
+    while (pos < size)
+    {
+        mp3dec_frame_info_t info{};
+        dec.reserv = -1;
+        int samples = mp3dec_decode_frame(&dec, data + pos, (int)(size - pos), nullptr, &info);
+        if (info.frame_bytes <= 0)
+            break;
+        if (info.hz > 0)
+        {
+            Mp3Frame f{};
+            f.offset = pos + info.frame_offset;
+            f.sample = sample;
+            f.pcm = pcm;
+            f.bytes = (uint32_t)(info.frame_bytes - info.frame_offset);
+            f.samples = (uint16_t)samples;
+            f.channels = (uint8_t)info.channels;
+            f.resync = dec.reserv != -1;
+            idx.frames_.push_back(f);
+            if (idx.rate_ == 0)
+                idx.rate_ = info.hz;
+            sample += (uint64_t)samples;
+            pcm += (uint64_t)samples * info.channels;
+        }
+        pos += info.frame_bytes;
+    }
+
+    idx.frame_samples_ = idx.frames_.empty() ? 0 : idx.frames_[0].samples;
+    for (const Mp3Frame &f : idx.frames_)
+        if (f.samples != idx.frame_samples_)
+            idx.frame_samples_ = 0;
+    return idx;
+}
+
+Mp3Index Mp3Index::open(const std::string &path, const MappedFile &input)
+{
+    const uint64_t hash = content_hash(input);
+    const std::string idx_path = index_path(path);
+    Mp3Index idx;
+    if (idx.load(idx_path, hash, input.size()))
+        return idx;
+    idx = build(input.data(), input.size());
+    idx.save(idx_path, hash, input.size());
+    return idx;
+}
+
+bool Mp3Index::save(const std::string &path, uint64_t content_hash, uint64_t file_size) const
+{
+    Mp3IndexHeader h{};
+    std::memcpy(h.magic, "SYNIDX", 7);
+    h.version = kMp3IndexVersion;
+    h.rate = (uint32_t)rate_;
+    h.content_hash = content_hash;
+    h.file_size = file_size;
+    h.frames = frames_.size();
+
+    const std::string tmp = path + ".tmp" + std::to_string(getpid());
+    std::FILE *f = std::fopen(tmp.c_str(), "wb");
+    if (!f)
+        return false;
+    bool ok = std::fwrite(&h, sizeof(h), 1, f) == 1 &&
+              std::fwrite(frames_.data(), sizeof(Mp3Frame), frames_.size(), f) == frames_.size();
+    ok = std::fclose(f) == 0 && ok;
+    if (!ok || std::rename(tmp.c_str(), path.c_str()) != 0)
+    {
+        std::remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool Mp3Index::load(const std::string &path, uint64_t content_hash, uint64_t file_size)
+{
+    std::FILE *f = std::fopen(path.c_str(), "rb");
+    if (!f)
+        return false;
+    Mp3IndexHeader h{};
+    bool ok = std::fread(&h, sizeof(h), 1, f) == 1 && std::memcmp(h.magic, "SYNIDX", 7) == 0 &&
+              h.version == kMp3IndexVersion && h.content_hash == content_hash && h.file_size == file_size &&
+              h.frames <= file_size / 4;
+    if (ok)
+    {
+        frames_.resize(h.frames);
+        ok = std::fread(frames_.data(), sizeof(Mp3Frame), frames_.size(), f) == frames_.size();
+    }
+    std::fclose(f);
+    if (!ok)
+    {
+        frames_.clear();
+        return false;
+    }
+    rate_ = (int)h.rate;
+    frame_samples_ = frames_.empty() ? 0 : frames_[0].samples;
+    for (const Mp3Frame &fr : frames_)
+        if (fr.samples != frame_samples_)
+            frame_samples_ = 0;
+    return true;
+}
+
+uint64_t Mp3Index::pcm_values(size_t first, size_t last) const
+{
+    if (first >= last)
+        return 0;
+    const Mp3Frame &end = frames_[last - 1];
+    return end.pcm + (uint64_t)end.samples * end.channels - frames_[first].pcm;
+}
+
+size_t Mp3Index::frame_at(uint64_t sample) const
+{
+    if (sample >= samples())
+        return frames_.size();
+    if (frame_samples_)
+        return (size_t)(sample / frame_samples_);
+    auto it = std::upper_bound(frames_.begin(), frames_.end(), sample,
+                               [](uint64_t s, const Mp3Frame &f) { return s < f.sample; });
+    return size_t(it - frames_.begin()) - 1;
+}
+
+size_t Mp3Index::warmup_start(size_t frame) const
+{
+    // A frame after a reset starts from a fresh decoder in the sequential
+    // pass too. Otherwise the frames before must decode in full, with their
+    // reservoir filled by the ones before them. One full frame carries the
+    // IMDCT overlap and filterbank history; the second is margin for
+    // MPEG-2/2.5 frames, which hold a single granule.
+    if (frame == 0 || frame >= frames_.size() || frames_[frame].resync)
+        return std::min(frame, frames_.size());
+    size_t s = frame - 1;
+    for (size_t full = 1; full < kFullWarmupFrames && s > 0 && !frames_[s].resync; ++full)
+        --s;
+    size_t have = 0;
+    while (s > 0 && !frames_[s].resync && have < kReservoirBytes)
+    {
+        --s;
+        have += frames_[s].bytes > kFrameOverhead ? frames_[s].bytes - kFrameOverhead : 0;
+    }
+    return s;
+}
+
+bool decode_frames(const uint8_t *data, size_t size, const Mp3Index &index, size_t first, size_t last,
+                   size_t from, int16_t *pcm, uint16_t *samples)
+{
+    if (first >= last)
+        return true;
+    mp3dec_t dec;
+    mp3dec_init(&dec);
+    if (from > 0 && !index[from].resync)
+        prime_sync(dec, data, index[from - 1]);
+    int16_t scratch[MINIMP3_MAX_SAMPLES_PER_FRAME];
+    const uint64_t base = index[first].pcm;
+    size_t pos = index[from].offset;
+    size_t i = from;
+    while (i < last && pos < size)
+    {
+        mp3dec_frame_info_t info{};
+        int16_t *out = i >= first ? pcm + (index[i].pcm - base) : scratch;
+        int n = mp3dec_decode_frame(&dec, data + pos, (int)(size - pos), out, &info);
+        if (info.frame_bytes <= 0)
+            break;
+        if (info.hz > 0)
+        {
+            // Every frame must be where the index has it, with its shape
+            const Mp3Frame &f = index[i];
+            if (pos + info.frame_offset != f.offset || info.channels != f.channels ||
+                (n != 0 && n != f.samples))
+                return false;
+            if (i >= first)
+                samples[i - first] = (uint16_t)n;
+            ++i;
+        }
+        pos += info.frame_bytes;
+    }
+    return i == last;
+}
+
+bool decode_parallel(const uint8_t *data, size_t size, const Mp3Index &index, size_t first, size_t last,
+                     WorkStealingPool &pool, int16_t *pcm, uint16_t *samples, size_t min_chunk)
+{
+    if (first >= last)
+        return true;
+    const size_t frames = last - first;
+    const size_t chunks = std::clamp<size_t>(frames / std::max<size_t>(min_chunk, 1), 1, (size_t)pool.size() * 4);
+    const uint64_t base = index[first].pcm;
+    std::atomic<bool> ok{true};
+    for (size_t c = 0; c < chunks; ++c)
+    {
+        const size_t a = first + frames * c / chunks, b = first + frames * (c + 1) / chunks;
+        pool.submit([&, a, b] {
+            const size_t from = index.warmup_start(a);
+            if (!decode_frames(data, size, index, a, b, from, pcm + (index[a].pcm - base), samples + (a - first)))
+                ok = false;
+        });
+    }
+    pool.wait_idle();
+    return ok;
+}
@@ -0,0 +1,92 @@
+#ifndef MP3_INDEX_H
+#define MP3_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "input.h"
+
+class WorkStealingPool;
+
+// One MP3 frame as a sequential mp3dec_decode_frame loop from byte 0 meets it
+struct Mp3Frame
+{
+    uint64_t offset;   // byte offset of the frame header
+    uint64_t sample;   // output samples (per channel) before this frame
+    uint64_t pcm;      // int16 values before this frame, all channels
+    uint32_t bytes;    // frame length, header included
+    uint16_t samples;  // per channel
+    uint8_t channels;  // 1 or 2
+    uint8_t resync;    // the decoder state was reset before this frame (stream start, lost sync)
+};
+
+// Frame table of an MP3 stream, built in one header-only pass (no
+// decoding), so a position in samples maps to a byte offset without
+// decoding what comes before it. Sample positions count every frame at its
+// nominal length; the decoder returns nothing for a frame whose bit
+// reservoir is missing, which only happens right after a resync.
+//
+// Decoding from the middle of a stream needs a few frames of warm-up:
+// Layer III frames borrow up to 511 bytes from earlier frames (the bit
+// reservoir), and the IMDCT overlap and synthesis filterbank carry one
+// granule of history. warmup_start() gives the first frame to feed a fresh
+// decoder so that every frame from there on decodes exactly as in a
+// sequential pass (see decode_frames()).
+class Mp3Index
+{
+public:
+    Mp3Index() = default;
+
+    // One pass over the headers of data
+    static Mp3Index build(const uint8_t *data, size_t size);
+
+    // Index of input kept next to it at index_path(path); rebuilt and
+    // rewritten when missing or stale (content hash, size). A directory that
+    // cannot be written to only costs the rebuild next time.
+    static Mp3Index open(const std::string &path, const MappedFile &input);
+    static std::string index_path(const std::string &path) { return path + ".idx"; }
+
+    bool save(const std::string &path, uint64_t content_hash, uint64_t file_size) const;
+    bool load(const std::string &path, uint64_t content_hash, uint64_t file_size);
+
+    size_t size() const { return frames_.size(); }
+    bool empty() const { return frames_.empty(); }
+    const Mp3Frame &operator[](size_t i) const { return frames_[i]; }
+    int rate() const { return rate_; }
+    uint64_t samples() const { return frames_.empty() ? 0 : frames_.back().sample + frames_.back().samples; }
+
+    // int16 values of frames [first, last)
+    uint64_t pcm_values(size_t first, size_t last) const;
+
+    // Frame holding output sample `sample` (size() past the end). O(1) when
+    // every frame has the same length, as in any single-layer stream.
+    size_t frame_at(uint64_t sample) const;
+
+    // First frame to decode so that `frame` comes out as in a sequential pass
+    size_t warmup_start(size_t frame) const;
+
+private:
+    std::vector<Mp3Frame> frames_;
+    int rate_ = 0;
+    uint32_t frame_samples_ = 0; // common frame length, 0 if they differ
+};
+
+// Decode frames [first, last) into pcm (index.pcm_values(first, last)
+// values, frame i at pcm + index[i].pcm - index[first].pcm) and the sample
+// count each produced into samples, bit for bit as a sequential pass from
+// the start of the stream would. The decoder starts at `from` (at most
+// first; index.warmup_start(first) is the latest exact choice) and the
+// output of the frames before first is dropped. Returns false if the stream
+// does not decode as indexed (corrupt or changed file).
+bool decode_frames(const uint8_t *data, size_t size, const Mp3Index &index, size_t first, size_t last,
+                   size_t from, int16_t *pcm, uint16_t *samples);
+
+// decode_frames() of [first, last) split at frame boundaries into chunks of
+// at least min_chunk frames, each warmed up on its own and decoded on pool.
+// Same output, bit for bit; the warm-up costs a few frames per chunk.
+bool decode_parallel(const uint8_t *data, size_t size, const Mp3Index &index, size_t first, size_t last,
+                     WorkStealingPool &pool, int16_t *pcm, uint16_t *samples, size_t min_chunk = 64);
+
+#endif
@@ -0,0 +1,323 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <numbers>
+
+#include "multichannel.h"
+#include "fft_kernels.h"
+#include "helpers.h"
+#include "input.h"
+#include "ring_buffer.h"
+#include "spatial.h"
+#include "wav.h"
+#include "../stats.h"
+
+static_assert(kMaxSpatialChannels == kMaxChannels, "covariance tile must fit every channel");
+
+void channel_covariance_scalar(const float *x, int channels, size_t frames, double *cov, float *planar)
+{
+    channel_covariance_loop(x, channels, frames, cov, planar);
+}
+
+namespace
+{
+
+ChannelCovarianceFn select_channel_covariance(FftIsa isa)
+{
+#if defined(SYN_FFT_X86)
+    switch (isa)
+    {
+    case FftIsa::Sse2: return channel_covariance_sse2;
+    case FftIsa::Avx2: return channel_covariance_avx2;
+    case FftIsa::Avx512: return channel_covariance_avx512;
+    default: break;
+    }
+#endif
+    (void)isa;
+    return channel_covariance_scalar;
+}
+
+// Below this GCC-PHAT peak a pair shares no source worth timing; its lag
+// would be noise, so its time difference counts as 0
+const double kMinCoherence = 0.1;
+
+const double kNoDirection = std::numeric_limits<double>::quiet_NaN();
+
+// Azimuth (+left) of each WAVE_FORMAT_EXTENSIBLE speaker bit, in bit order;
+// LFE and the top centre have no horizontal direction
+const double kSpeakerAzimuth[] = {
+    30, -30, 0, kNoDirection, 150, -150, 15, -15, 180, 90, -90, // front L/R/C, LFE, back L/R, FLC, FRC, BC, side L/R
+    kNoDirection, 30, 0, -30, 150, 180, -150,                   // top: centre, front L/C/R, back L/C/R
+};
+
+// Masks assumed when the file gives none: mono, stereo, 3.0, quad, 5.0, 5.1, -, 7.1
+const uint32_t kDefaultMask[] = {0, 0x4, 0x3, 0x7, 0x33, 0x37, 0x3F, 0, 0x63F};
+
+} // namespace
+
+void channel_covariance(const float *x, int channels, size_t frames, double *cov, float *planar, FftIsa isa)
+{
+    select_channel_covariance(isa)(x, channels, frames, cov, planar);
+}
+
+ChannelLayout ChannelLayout::from_mask(uint32_t mask, int channels)
+{
+    ChannelLayout l;
+    if (mask == 0 && channels < (int)std::size(kDefaultMask))
+        mask = kDefaultMask[channels];
+    if (mask == 0)
+    {
+        // Evenly spaced ring, first channel ahead
+        for (int c = 0; c < channels; ++c)
+            l.azimuth_deg.push_back(std::remainder(360.0 * c / channels, 360.0));
+        return l;
+    }
+    for (int bit = 0; bit < 32 && l.channels() < channels; ++bit)
+        if (mask & (1u << bit))
+            l.azimuth_deg.push_back(bit < (int)std::size(kSpeakerAzimuth) ? kSpeakerAzimuth[bit] : kNoDirection);
+    l.azimuth_deg.resize(channels, kNoDirection); // channels beyond the mask
+    return l;
+}
+
+ChannelLayout ChannelLayout::ambix(int channels)
+{
+    ChannelLayout l;
+    l.azimuth_deg.assign(channels, kNoDirection);
+    l.ambisonic = true;
+    return l;
+}
+
+MultiGccPhat::MultiGccPhat(int N, int channels)
+    : N_(N), fft_(N), spectra_((size_t)channels * (N / 2 + 1)), G_(N / 2 + 1), cc_(N)
+{
+}
+
+void MultiGccPhat::transform(const float *planar)
+{
+    const size_t bins = N_ / 2 + 1;
+    for (size_t c = 0; c < spectra_.size() / bins; ++c)
+        fft_.forward(planar + c * N_, &spectra_[c * bins]);
+}
+
+double MultiGccPhat::lag(int i, int j, int maxLag, double *peak)
+{
+    const int N = N_;
+    const int Nh = N / 2;
+    maxLag = std::min(maxLag, Nh - 1);
+
+    // conj(Xi) * Xj correlates x_i[n] with x_j[n + lag]; PHAT keeps its phase only
+    const cf *Xi = &spectra_[(size_t)i * (Nh + 1)];
+    const cf *Xj = &spectra_[(size_t)j * (Nh + 1)];
+    for (int k = 0; k <= Nh; ++k)
+    {
+        cf C = std::conj(Xi[k]) * Xj[k];
+        float m = std::sqrt(C.real() * C.real() + C.imag() * C.imag());
+        G_[k] = m > 1e-20f ? C / m : cf(0.0f, 0.0f);
+    }
+    // Bins 0 and N/2 of a real spectrum have no imaginary part
+    G_[0] = cf(G_[0].real(), 0.0f);
+    G_[Nh] = cf(G_[Nh].real(), 0.0f);
+
+    fft_.inverse(G_.data(), cc_.data());
+
+    auto at = [&](int lag) { return double(cc_[(lag + N) & (N - 1)]); };
+    int best = 0;
+    double bestVal = -1e300;
+    for (int l = -maxLag; l <= maxLag; ++l)
+    {
+        double v = at(l);
+        if (v > bestVal)
+        {
+            bestVal = v;
+            best = l;
+        }
+    }
+
+    double m1 = at(best - 1), m0 = bestVal, p1 = at(best + 1);
+    if (peak)
+        *peak = m0;
+    double denom = m1 - 2.0 * m0 + p1;
+    if (std::abs(denom) < 1e-12)
+        return (double)best;
+    return (double)best + clamp(0.5 * (m1 - p1) / denom, -0.5, 0.5);
+}
+
+MultiChannelAnalyzer::MultiChannelAnalyzer(int rate, const ChannelLayout &layout, const AnalysisParams &params)
+    : p_(params), rate_(rate), layout_(layout), gcc_(params.N, layout.channels()),
+      cov_((size_t)layout.channels() * layout.channels()), planar_((size_t)layout.channels() * params.N)
+{
+}
+
+MultiHopFeatures MultiChannelAnalyzer::analyze(const float *x, uint64_t sample)
+{
+    const int C = layout_.channels();
+    const int N = p_.N;
+
+    MultiHopFeatures f{};
+    f.sample = sample;
+    f.channels = C;
+    f.pairs = C * (C - 1) / 2;
+
+    // Every channel energy and cross term in one pass, de-interleaving on the way
+    std::fill(cov_.begin(), cov_.end(), 0.0);
+    {
+        SYN_TIME(Stage::Spatial);
+        channel_covariance(x, C, N, cov_.data(), planar_.data());
+        for (int c = 0; c < C; ++c)
+            f.level_db[c] = db10(cov_[c * C + c] / N);
+
+        if (!layout_.ambisonic)
+            gcc_.transform(planar_.data());
+        const int maxLag = (int)std::round(p_.itd_max_sec * rate_);
+        int p = 0;
+        for (int i = 0; i < C; ++i)
+            for (int j = i + 1; j < C; ++j, ++p)
+            {
+                f.ild_db[p] = db10(cov_[j * C + j] / std::max(cov_[i * C + i], 1e-20));
+                double peak = 0.0, lag = layout_.ambisonic ? 0.0 : gcc_.lag(i, j, maxLag, &peak);
+                f.itd_sec[p] = peak >= kMinCoherence ? lag / rate_ : 0.0;
+            }
+
+        if (layout_.ambisonic)
+            ambisonic_direction(f);
+        else
+            speaker_direction(f);
+    }
+    return f;
+}
+
+// Each pair of positioned channels votes for a direction on the arc between
+// them, placed by the stereo model (azimuth_from_ild_itd with i as left, j as
+// right) and weighted by the pair's energy; the votes are averaged as unit
+// vectors. A pair at +/-90 degrees gives the stereo azimuth itself.
+void MultiChannelAnalyzer::speaker_direction(MultiHopFeatures &f) const
+{
+    const int C = layout_.channels();
+    const double deg = std::numbers::pi / 180.0;
+    double x = 0.0, y = 0.0, total = 0.0;
+    int p = 0;
+    for (int i = 0; i < C; ++i)
+        for (int j = i + 1; j < C; ++j, ++p)
+        {
+            const double ai = layout_.azimuth_deg[i], aj = layout_.azimuth_deg[j];
+            if (std::isnan(ai) || std::isnan(aj))
+                continue;
+            // Arc from j to i the short way; opposite speakers take the way ahead
+            double span = std::remainder(ai - aj, 360.0);
+            if (std::abs(span) == 180.0 && std::cos((aj + span / 2) * deg) < 0.0)
+                span = -span;
+            double s = azimuth_from_ild_itd(f.ild_db[p], f.itd_sec[p]) / 90.0; // +1 at i, -1 at j
+            double theta = (aj + span * 0.5 * (1.0 + s)) * deg;
+            double w = cov_[i * C + i] + cov_[j * C + j];
+            x += w * std::cos(theta);
+            y += w * std::sin(theta);
+            total += w;
+        }
+    f.azimuth_deg = std::atan2(y, x) / deg;
+    f.spread = total > 0.0 ? clamp(1.0 - std::hypot(x, y) / total, 0.0, 1.0) : 1.0;
+}
+
+// Active intensity of a first-order sound field: the W-X and W-Y cross terms
+// point towards the source. For SN3D a plane wave has |I| = E_W.
+void MultiChannelAnalyzer::ambisonic_direction(MultiHopFeatures &f) const
+{
+    const int C = layout_.channels();
+    if (C < 4)
+    {
+        f.azimuth_deg = 0.0;
+        f.spread = 1.0;
+        return;
+    }
+    const double W2 = cov_[0], Iy = cov_[1], Ix = cov_[3]; // ACN: W Y Z X
+    f.azimuth_deg = std::atan2(Iy, Ix) * 180.0 / std::numbers::pi;
+    f.spread = W2 > 0.0 ? clamp(1.0 - std::hypot(Ix, Iy) / W2, 0.0, 1.0) : 1.0;
+}
+
+int run_spatial(const SpatialOptions &opt)
+{
+    const auto t_start = std::chrono::steady_clock::now();
+
+    std::unique_ptr<MappedFile> input;
+    try
+    {
+        input = std::make_unique<MappedFile>(opt.input);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << '\n';
+        return 1;
+    }
+    WavFormat fmt;
+    if (!parse_wav(input->data(), input->size(), fmt))
+    {
+        std::cerr << "Not a PCM WAV file: " << opt.input << '\n';
+        return 1;
+    }
+    const int C = fmt.channels;
+    if (C < 2 || C > kMaxSpatialChannels)
+    {
+        std::cerr << "Spatial analysis needs 2 to " << kMaxSpatialChannels << " channels, got " << C << '\n';
+        return 1;
+    }
+
+    const AnalysisParams &p = opt.params;
+    ChannelLayout layout = opt.ambisonic ? ChannelLayout::ambix(C) : ChannelLayout::from_mask(fmt.channel_mask, C);
+    MultiChannelAnalyzer analyzer(fmt.rate, layout, p);
+
+    FILE *out = opt.output == "-" ? stdout : std::fopen(opt.output.c_str(), "w");
+    if (!out)
+    {
+        std::perror(opt.output.c_str());
+        return 1;
+    }
+    std::fprintf(out, "sample,time,azimuth_deg,spread");
+    for (int c = 0; c < C; ++c)
+        std::fprintf(out, ",level_db_%d", c);
+    for (int i = 0; i < C; ++i)
+        for (int j = i + 1; j < C; ++j)
+            std::fprintf(out, ",ild_db_%d_%d,itd_sec_%d_%d", i, j, i, j);
+    std::fprintf(out, "\n");
+
+    // Interleaved float window, advanced one hop at a time
+    SampleRing<float> ring((size_t)(p.N + p.hop) * C, (size_t)p.N * C);
+    std::vector<float> block((size_t)p.hop * C);
+    const uint8_t *pcm = input->data() + fmt.data_offset;
+    uint64_t sample = 0, hops = 0;
+    for (size_t pos = 0; pos < fmt.frames;)
+    {
+        const size_t n = std::min<size_t>(p.hop, fmt.frames - pos);
+        wav_to_float(fmt, pcm + pos * fmt.frame_bytes(), n, block.data());
+        ring.push(block.data(), n * C);
+        pos += n;
+        input->release(fmt.data_offset + pos * fmt.frame_bytes());
+
+        while (ring.size() >= (size_t)p.N * C)
+        {
+            MultiHopFeatures f = analyzer.analyze(ring.peek(), sample);
+            std::fprintf(out, "%llu,%.6f,%.4f,%.4f", (unsigned long long)f.sample, double(f.sample) / fmt.rate,
+                         f.azimuth_deg, f.spread);
+            for (int c = 0; c < C; ++c)
+                std::fprintf(out, ",%.4f", f.level_db[c]);
+            for (int k = 0; k < f.pairs; ++k)
+                std::fprintf(out, ",%.4f,%.8f", f.ild_db[k], f.itd_sec[k]);
+            std::fprintf(out, "\n");
+            ring.consume((size_t)p.hop * C);
+            sample += p.hop;
+            hops++;
+        }
+    }
+    if (out != stdout)
+        std::fclose(out);
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count();
+    double audio_sec = double(fmt.frames) / fmt.rate;
+    std::fprintf(stderr, "%s: %d channels, %.1f s of audio, %llu hops in %.2f s (%.1fx realtime)\n",
+                 opt.input.c_str(), C, audio_sec, (unsigned long long)hops, elapsed,
+                 audio_sec / std::max(elapsed, 1e-9));
+    return 0;
+}
@@ -0,0 +1,113 @@
+#ifndef MULTICHANNEL_H
+#define MULTICHANNEL_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "analysis.h"
+#include "fourier.h"
+
+// Spatial analysis of N-channel PCM (WAV stems, 5.1/7.1, first-order
+// ambisonics): per-channel levels, level and time differences for every
+// channel pair, and a direction on the horizontal plane.
+
+constexpr int kMaxSpatialChannels = 16;
+constexpr int kMaxChannelPairs = kMaxSpatialChannels * (kMaxSpatialChannels - 1) / 2;
+
+// cov[i * channels + j] += sum of x_i * x_j over `frames` interleaved frames,
+// for every i <= j, in one vectorized pass. The diagonal holds the channel
+// energies. planar, if given, receives the channels de-interleaved
+// (channel c at planar + c * frames).
+void channel_covariance(const float *x, int channels, size_t frames, double *cov, float *planar = nullptr,
+                        FftIsa isa = fft_detect_isa());
+
+// Where each channel sits on the horizontal plane
+struct ChannelLayout
+{
+    std::vector<double> azimuth_deg; // +left, 0 ahead; NaN for channels without a direction (LFE)
+    bool ambisonic = false;          // first-order AmbiX (ACN order W Y Z X, SN3D) instead of speaker feeds
+
+    int channels() const { return (int)azimuth_deg.size(); }
+
+    // From a WAVE_FORMAT_EXTENSIBLE speaker mask; without one, the usual
+    // layout for the channel count (stereo, quad, 5.0, 5.1, 7.1) or a ring
+    static ChannelLayout from_mask(uint32_t mask, int channels);
+    static ChannelLayout ambix(int channels);
+};
+
+// Spatial features of one hop. Pairs (i, j), i < j, are in the order
+// (0,1), (0,2), ..., (1,2), ...
+struct MultiHopFeatures
+{
+    uint64_t sample; // first frame of the analysis window
+    int channels;
+    int pairs;
+    double level_db[kMaxSpatialChannels]; // mean power, dBFS
+    double ild_db[kMaxChannelPairs];      // 10 log10(E_j / E_i)
+    double itd_sec[kMaxChannelPairs];     // lag of j against i, positive when j is delayed; 0 if incoherent or ambisonic
+    double azimuth_deg;                   // +left, 0 ahead
+    double spread;                        // 0 for a single direction, 1 for none (diffuse or silent)
+};
+
+// GCC-PHAT for every channel pair. Each channel is transformed once per
+// hop, then each pair costs one whitened cross-spectrum and one inverse FFT,
+// instead of two forward transforms per pair as with GccPhat.
+class MultiGccPhat
+{
+public:
+    MultiGccPhat(int N, int channels);
+
+    // planar: channels x N samples, channel c at planar + c * N
+    void transform(const float *planar);
+
+    // Fractional lag of channel j against channel i in +/- maxLag samples,
+    // positive when j is delayed (GccPhat convention with L = i, R = j).
+    // peak, if given, gets the correlation there: about 1 for one coherent
+    // source, near 0 for unrelated channels.
+    double lag(int i, int j, int maxLag, double *peak = nullptr);
+
+private:
+    int N_;
+    RealFftF fft_;
+    std::vector<cf> spectra_; // bins 0..N/2 of each channel
+    std::vector<cf> G_;       // whitened cross-spectrum
+    std::vector<float> cc_;   // circular cross-correlation
+};
+
+// Everything run_spatial computes for one N-frame window. One per thread.
+class MultiChannelAnalyzer
+{
+public:
+    MultiChannelAnalyzer(int rate, const ChannelLayout &layout, const AnalysisParams &params = {});
+
+    const AnalysisParams &params() const { return p_; }
+
+    // x: params().N interleaved frames of layout.channels() channels
+    MultiHopFeatures analyze(const float *x, uint64_t sample);
+
+private:
+    void speaker_direction(MultiHopFeatures &f) const;
+    void ambisonic_direction(MultiHopFeatures &f) const;
+
+    AnalysisParams p_;
+    int rate_;
+    ChannelLayout layout_;
+    MultiGccPhat gcc_;
+    std::vector<double> cov_;   // channels x channels, upper triangle
+    std::vector<float> planar_; // de-interleaved window
+};
+
+// Headless N-channel analysis of a WAV file, one CSV row per hop
+struct SpatialOptions
+{
+    std::string input;
+    std::string output;     // CSV, - for stdout
+    bool ambisonic = false; // treat the channels as AmbiX instead of speaker feeds
+    AnalysisParams params;
+};
+
+// Returns a process exit code
+int run_spatial(const SpatialOptions &opt);
+
+#endif
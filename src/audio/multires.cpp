@@ -0,0 +1,233 @@
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+#include "multires.h"
+#include "decoder.h"
+#include "helpers.h"
+#include "../stats.h"
+
+namespace
+{
+
+// Below any peak threshold: hides the other band from peaks_selector
+const double kMaskedDb = -200.0;
+
+// Blackman-windowed sinc low-pass, unity gain at DC, cutoff at 80% of the
+// decimated Nyquist; 8 taps per decimation step
+std::vector<float> make_lowpass(int decimation)
+{
+    const int K = 8 * decimation - 1;
+    const double fc = 0.8 * 0.5 / decimation; // cycles per input sample
+    std::vector<double> h(K);
+    double sum = 0.0;
+    for (int k = 0; k < K; ++k)
+    {
+        double t = k - (K - 1) / 2.0;
+        double sinc = t == 0.0 ? 2.0 * fc : std::sin(2.0 * std::numbers::pi * fc * t) / (std::numbers::pi * t);
+        double w = 0.42 - 0.5 * std::cos(2.0 * std::numbers::pi * k / (K - 1)) +
+                   0.08 * std::cos(4.0 * std::numbers::pi * k / (K - 1));
+        h[k] = sinc * w;
+        sum += h[k];
+    }
+    std::vector<float> taps(K);
+    for (int k = 0; k < K; ++k)
+        taps[k] = float(h[k] / sum);
+    return taps;
+}
+
+// dBFS of bins 0..N/2 of an N-point real FFT of a Hann-windowed signal
+void spectrum_db(const std::vector<cd> &X, int N, std::vector<double> &db)
+{
+    SYN_TIME(Stage::Magnitude);
+    for (int k = 0; k <= N / 2; ++k)
+        db[k] = 20.0 * std::log10(std::abs(X[k]) / (N * 0.5));
+}
+
+uint64_t centre(const CircleEvent &e) { return e.sample + e.span / 2; }
+
+} // namespace
+
+MultiResAnalyzer::MultiResAnalyzer(int rate, const MultiResParams &params)
+    : p_(params), rate_(rate), low_rate_(rate / params.decimation),
+      left_(params.high_N + 4096, params.high_N), right_(params.high_N + 4096, params.high_N),
+      mid_(params.high_N + 4096, params.high_N), high_fft_(params.high_N), gcc_(params.high_N, rate),
+      high_hann_(params.high_N), high_xw_(params.high_N), high_db_(params.high_N / 2 + 1),
+      high_X_(params.high_N / 2 + 1), taps_(make_lowpass(params.decimation)), hist_(2 * taps_.size(), 0.0f),
+      low_(params.low_N + 1024, params.low_N), low_fft_(params.low_N), low_hann_(params.low_N),
+      low_xw_(params.low_N), low_db_(params.low_N / 2 + 1), low_X_(params.low_N / 2 + 1),
+      peaks_(params.max_peaks), timbre_(kMaxHarmonics)
+{
+    make_hann(high_hann_);
+    make_hann(low_hann_);
+    lowpass_delay_ = (int)(taps_.size() - 1) / 2;
+    high_first_bin_ = (int)std::ceil(p_.crossover_hz * p_.high_N / rate_);
+    // Two bins of context past the crossover so a peak right at it is still found
+    low_last_bin_ = std::min(p_.low_N / 2, (int)(p_.crossover_hz * p_.low_N / low_rate_) + 2);
+}
+
+void MultiResAnalyzer::push(const float *L, const float *R, const float *M, size_t n,
+                            std::vector<CircleEvent> &events, std::vector<HopFeatures> *features)
+{
+    size_t off = 0;
+    while (off < n)
+    {
+        size_t take = std::min({n - off, mid_.free_space(), low_.free_space() * p_.decimation});
+        left_.push(L + off, take);
+        right_.push(R + off, take);
+        mid_.push(M + off, take);
+        decimate(M + off, take);
+        off += take;
+
+        while (low_.size() >= (size_t)p_.low_N)
+            analyze_low();
+        while (mid_.size() >= (size_t)p_.high_N)
+            analyze_high(features);
+        release(events, std::min(high_sample_ + p_.high_N / 2, next_low_centre()));
+    }
+}
+
+void MultiResAnalyzer::flush(std::vector<CircleEvent> &events)
+{
+    release(events, UINT64_MAX);
+}
+
+// Keep held_ sorted by centre as events arrive (stable: after equal centres);
+// std::stable_sort would allocate a merge buffer on every release
+void MultiResAnalyzer::hold(const CircleEvent &e)
+{
+    auto at = std::upper_bound(held_.begin(), held_.end(), centre(e),
+                               [](uint64_t c, const CircleEvent &h) { return c < centre(h); });
+    held_.insert(at, e);
+}
+
+void MultiResAnalyzer::release(std::vector<CircleEvent> &events, uint64_t before)
+{
+    size_t i = 0;
+    while (i < held_.size() && centre(held_[i]) < before)
+        events.push_back(held_[i++]);
+    held_.erase(held_.begin(), held_.begin() + i);
+}
+
+// Input position of the next long window's first sample, plus half its span
+uint64_t MultiResAnalyzer::next_low_centre() const
+{
+    const int64_t D = p_.decimation;
+    int64_t start = (int64_t)low_start_ * D + (D - 1) - lowpass_delay_;
+    return (uint64_t)std::max<int64_t>(start, 0) + (uint64_t)p_.low_N * D / 2;
+}
+
+void MultiResAnalyzer::decimate(const float *M, size_t n)
+{
+    const size_t K = taps_.size();
+    for (size_t i = 0; i < n; ++i)
+    {
+        hist_pos_ = hist_pos_ + 1 == K ? 0 : hist_pos_ + 1;
+        hist_[hist_pos_] = hist_[hist_pos_ + K] = M[i];
+        if (++phase_ < p_.decimation)
+            continue;
+        phase_ = 0;
+        const float *h = &hist_[hist_pos_ + 1]; // oldest to newest
+        float acc = 0.0f;
+        for (size_t k = 0; k < K; ++k)
+            acc += taps_[k] * h[k];
+        low_.push(&acc, 1);
+    }
+}
+
+void MultiResAnalyzer::analyze_low()
+{
+    const int N = p_.low_N;
+    const int D = p_.decimation;
+    {
+        SYN_TIME(Stage::Window);
+        const float *x = low_.peek();
+        for (int n = 0; n < N; ++n)
+            low_xw_[n] = double(x[n]) * low_hann_[n];
+    }
+    {
+        SYN_TIME(Stage::Fft);
+        low_fft_.forward(low_xw_.data(), low_X_.data());
+    }
+    spectrum_db(low_X_, N, low_db_);
+
+    size_t peaks;
+    {
+        SYN_TIME(Stage::Peaks);
+        peaks = peaks_selector(std::span<const double>(low_db_).first(low_last_bin_ + 1), p_.peak_thresh_db,
+                               std::span(peaks_));
+    }
+
+    int64_t start = (int64_t)low_start_ * D + (D - 1) - lowpass_delay_;
+    for (size_t i = 0; i < peaks; ++i)
+    {
+        auto [bin, db] = peaks_[i];
+        hold(circle_from_peak(low_db_, bin, db, low_rate_, N, (uint64_t)std::max<int64_t>(start, 0),
+                              (uint32_t)(N * D), timbre_));
+    }
+
+    low_start_ += p_.low_hop;
+    low_.consume(p_.low_hop);
+}
+
+void MultiResAnalyzer::analyze_high(std::vector<HopFeatures> *features)
+{
+    const int N = p_.high_N;
+    const uint64_t hops_per_low = std::max<uint64_t>(1, (uint64_t)p_.low_hop * p_.decimation / p_.high_hop);
+    {
+        SYN_TIME(Stage::Window);
+        const float *x = mid_.peek();
+        for (int n = 0; n < N; ++n)
+            high_xw_[n] = double(x[n]) * high_hann_[n];
+    }
+    {
+        SYN_TIME(Stage::Fft);
+        high_fft_.forward(high_xw_.data(), high_X_.data());
+    }
+    spectrum_db(high_X_, N, high_db_);
+    std::fill(high_db_.begin(), high_db_.begin() + std::min(high_first_bin_, N / 2 + 1), kMaskedDb);
+
+    size_t peaks;
+    {
+        SYN_TIME(Stage::Peaks);
+        peaks = peaks_selector(high_db_, p_.peak_thresh_db, std::span(peaks_));
+    }
+
+    // New partials now, sustained ones once per low hop
+    tracked_next_.clear();
+    for (size_t i = 0; i < peaks; ++i)
+    {
+        auto [bin, db] = peaks_[i];
+        auto it = std::find_if(tracked_.begin(), tracked_.end(),
+                               [b = bin](const Tracked &t) { return std::abs(t.bin - b) <= 1; });
+        uint64_t shown = high_hops_;
+        if (it != tracked_.end() && high_hops_ - it->shown < hops_per_low)
+            shown = it->shown;
+        else
+            hold(circle_from_peak(high_db_, bin, db, rate_, N, high_sample_, (uint32_t)N, timbre_));
+        tracked_next_.push_back({bin, shown});
+    }
+    tracked_.swap(tracked_next_);
+
+    if (features && high_hops_ % hops_per_low == 0)
+    {
+        SYN_TIME(Stage::Spatial);
+        const float *Lw = left_.peek(), *Rw = right_.peek();
+        HopFeatures f{};
+        f.sample = high_sample_;
+        SpatialSums sums; // one pass: these windows do not overlap, nothing to carry over
+        sums.add(Lw, Rw, N);
+        f.ild_db = db10(sums.R2 / sums.L2);
+        f.itd_sec = gcc_.lag(Lw, Rw, (int)std::round(p_.itd_max_sec * rate_)) / double(rate_);
+        f.azimuth_deg = azimuth_from_ild_itd(f.ild_db, f.itd_sec);
+        f.width_db = sums.width_db();
+        f.peaks = (int)peaks;
+        features->push_back(f);
+    }
+
+    high_hops_++;
+    high_sample_ += p_.high_hop;
+    left_.consume(p_.high_hop);
+    right_.consume(p_.high_hop);
+    mid_.consume(p_.high_hop);
+}
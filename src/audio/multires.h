@@ -0,0 +1,103 @@
+#ifndef MULTIRES_H
+#define MULTIRES_H
+
+#include <cstdint>
+#include <vector>
+
+#include "analysis.h"
+#include "fourier.h"
+#include "ring_buffer.h"
+#include "spatial.h"
+
+// Multi-resolution STFT parameters. Bass keeps the long window's frequency
+// resolution by analyzing the Mid signal decimated by `decimation`; everything
+// above crossover_hz uses a short full-rate window with a short hop.
+struct MultiResParams
+{
+    int decimation = 8;
+    int low_N = 2048;           // decimated samples (16384 at the input rate)
+    int low_hop = 512;          // decimated samples (4096 at the input rate)
+    int high_N = 2048;          // input samples
+    int high_hop = 512;         // input samples (~11 ms at 48 kHz)
+    double crossover_hz = 500.0;
+    int peak_thresh_db = kPeakThreshDb;
+    int max_peaks = kMaxPeaksPerHop; // per band and hop
+    double itd_max_sec = 0.001;
+};
+
+// Push-driven analyzer producing the same CircleEvents as HopAnalyzer.
+//
+// High band: every high_hop the short spectrum's top peaks above the
+// crossover become circles when they are new (no peak within one bin on the
+// previous hop) or have not been shown for one low hop, so onsets appear at
+// the short hop rate while sustained partials keep the long-hop cadence.
+// Low band: every low hop the decimated spectrum's peaks below the crossover.
+// Spatial features are computed on the short window once per low hop.
+//
+// Events leave in order of their window centre (sample + span / 2), the order
+// in which they become audible; bass events lag the short window, so high
+// band events are held until no earlier bass event can still appear.
+class MultiResAnalyzer
+{
+public:
+    MultiResAnalyzer(int rate, const MultiResParams &params = {});
+
+    const MultiResParams &params() const { return p_; }
+
+    // Feed n samples; finished events are appended to events and, if given,
+    // spatial features to features
+    void push(const float *L, const float *R, const float *M, size_t n, std::vector<CircleEvent> &events,
+              std::vector<HopFeatures> *features = nullptr);
+
+    // End of stream: release every held event
+    void flush(std::vector<CircleEvent> &events);
+
+private:
+    void analyze_high(std::vector<HopFeatures> *features);
+    void analyze_low();
+    void decimate(const float *M, size_t n);
+    void hold(const CircleEvent &e);
+    void release(std::vector<CircleEvent> &events, uint64_t before);
+    uint64_t next_low_centre() const;
+
+    MultiResParams p_;
+    int rate_;
+    int low_rate_;
+    int lowpass_delay_; // group delay of the decimation filter, input samples
+
+    // Full rate: short window
+    SampleRing<float> left_, right_, mid_;
+    uint64_t high_sample_ = 0; // first sample of the next short window
+    uint64_t high_hops_ = 0;
+    RealFft high_fft_;
+    GccPhat gcc_;
+    std::vector<double> high_hann_, high_xw_, high_db_;
+    std::vector<cd> high_X_;
+    int high_first_bin_;
+    struct Tracked
+    {
+        int bin;
+        uint64_t shown; // high hop it was last emitted on
+    };
+    std::vector<Tracked> tracked_, tracked_next_;
+
+    // Decimated Mid: long window
+    std::vector<float> taps_;
+    std::vector<float> hist_; // last taps_.size() inputs, stored twice for a contiguous dot product
+    size_t hist_pos_ = 0;
+    int phase_ = 0;
+    SampleRing<float> low_;
+    uint64_t low_start_ = 0; // decimated index of the next long window
+    RealFft low_fft_;
+    std::vector<double> low_hann_, low_xw_, low_db_;
+    std::vector<cd> low_X_;
+    int low_last_bin_;
+
+    // Per-analysis scratch, shared by both bands
+    std::vector<std::pair<int, double>> peaks_;
+    std::vector<double> timbre_;
+
+    std::vector<CircleEvent> held_;
+};
+
+#endif
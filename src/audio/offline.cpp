@@ -0,0 +1,413 @@
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "offline.h"
+#include "helpers.h"
+#include "input.h"
+#include "feature_writer.h"
+#include "mp3_index.h"
+#include "ring_buffer.h"
+#include "scheduler.h"
+#include "tracker.h"
+
+#define MINIMP3_ONLY_MP3
+#include "../../external/minimp3/minimp3.h"
+
+namespace
+{
+
+// A run of consecutive hops and the samples they cover
+struct Segment
+{
+    uint64_t first_sample = 0; // stream position of L[0]
+    int hops = 0;
+    std::vector<float> L, R, M;
+    std::vector<HopFeatures> features;
+    std::vector<uint32_t> counts; // circle events per hop
+    std::vector<CircleEvent> events;
+    bool done = false;
+};
+
+// Decode-ordered segments, analyzed out of order by the workers
+class SegmentPipeline
+{
+public:
+    SegmentPipeline(int rate, const AnalysisParams &p, int threads, FeatureWriter &out)
+        : rate_(rate), params_(p), out_(out), max_inflight_((size_t)threads * 2)
+    {
+        for (int i = 0; i < threads; ++i)
+            workers_.emplace_back([this] { work(); });
+    }
+
+    ~SegmentPipeline() { finish(); }
+
+    // Hand a filled segment over; blocks while too many are in flight
+    void submit(std::unique_ptr<Segment> s)
+    {
+        std::unique_lock<std::mutex> lk(mtx_);
+        todo_.push_back(s.get());
+        inflight_.push_back(std::move(s));
+        work_cv_.notify_one();
+        drain(lk, max_inflight_);
+    }
+
+    // Wait for every segment and write the rest out
+    void finish()
+    {
+        std::unique_lock<std::mutex> lk(mtx_);
+        drain(lk, 1);
+        stop_ = true;
+        work_cv_.notify_all();
+        lk.unlock();
+        for (std::thread &t : workers_)
+            t.join();
+        workers_.clear();
+    }
+
+    uint64_t hops() const { return hops_; }
+    uint64_t events() const { return events_; }
+
+private:
+    // Write finished segments in order until fewer than limit are in flight
+    void drain(std::unique_lock<std::mutex> &lk, size_t limit)
+    {
+        while (!inflight_.empty())
+        {
+            if (inflight_.front()->done)
+            {
+                std::unique_ptr<Segment> s = std::move(inflight_.front());
+                inflight_.pop_front();
+                write_segment(*s);
+                hops_ += s->hops;
+                events_ += s->events.size();
+                continue;
+            }
+            if (inflight_.size() < limit)
+                break;
+            done_cv_.wait(lk);
+        }
+    }
+
+    void write_segment(const Segment &s)
+    {
+        size_t e = 0;
+        for (int h = 0; h < s.hops; ++h)
+        {
+            out_.write(s.features[h], s.events.data() + e, s.counts[h]);
+            e += s.counts[h];
+        }
+    }
+
+    void work()
+    {
+        HopAnalyzer analyzer(rate_, params_);
+        const int HOP = params_.hop;
+        for (;;)
+        {
+            Segment *s;
+            {
+                std::unique_lock<std::mutex> lk(mtx_);
+                work_cv_.wait(lk, [this] { return stop_ || !todo_.empty(); });
+                if (todo_.empty())
+                    return;
+                s = todo_.front();
+                todo_.pop_front();
+            }
+
+            s->features.resize(s->hops);
+            s->counts.resize(s->hops);
+            for (int h = 0; h < s->hops; ++h)
+            {
+                size_t off = (size_t)h * HOP;
+                size_t before = s->events.size();
+                s->features[h] = analyzer.analyze(s->L.data() + off, s->R.data() + off, s->M.data() + off,
+                                                  s->first_sample + off, s->events);
+                s->counts[h] = (uint32_t)(s->events.size() - before);
+            }
+
+            std::lock_guard<std::mutex> lk(mtx_);
+            s->done = true;
+            done_cv_.notify_all();
+        }
+    }
+
+    int rate_;
+    AnalysisParams params_;
+    FeatureWriter &out_;
+    size_t max_inflight_;
+    std::mutex mtx_;
+    std::condition_variable work_cv_, done_cv_;
+    std::deque<std::unique_ptr<Segment>> inflight_; // decode order
+    std::deque<Segment *> todo_;
+    std::vector<std::thread> workers_;
+    bool stop_ = false;
+    uint64_t hops_ = 0, events_ = 0;
+};
+
+// Sample rate of the first frame, 0 if there is none
+int probe_rate(const MappedFile &input)
+{
+    mp3dec_t dec;
+    mp3dec_init(&dec);
+    mp3dec_frame_info_t info{};
+    mp3dec_decode_frame(&dec, input.data(), (int)input.size(), nullptr, &info);
+    return info.hz;
+}
+
+} // namespace
+
+int run_offline(const OfflineOptions &opt)
+{
+    const auto t_start = std::chrono::steady_clock::now();
+
+    std::unique_ptr<MappedFile> input;
+    try
+    {
+        input = std::make_unique<MappedFile>(opt.input);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << '\n';
+        return 1;
+    }
+
+    const Mp3Index index =
+        opt.keep_index ? Mp3Index::open(opt.input, *input) : Mp3Index::build(input->data(), input->size());
+    const int rate = index.rate();
+    if (index.empty() || rate <= 0)
+    {
+        std::cerr << "No MP3 frames in: " << opt.input << '\n';
+        return 1;
+    }
+
+    float Lf[MINIMP3_MAX_SAMPLES_PER_FRAME], Rf[MINIMP3_MAX_SAMPLES_PER_FRAME], Mf[MINIMP3_MAX_SAMPLES_PER_FRAME];
+
+    const AnalysisParams &p = opt.params;
+    const int S = std::max(1, opt.segment_hops);
+    const size_t span = (size_t)(S - 1) * p.hop + p.N; // samples per full segment
+    int threads = opt.threads > 0 ? opt.threads : (int)std::max(1u, std::thread::hardware_concurrency());
+
+    FeatureWriter out(opt.output, rate, p);
+    if (!out.ok())
+    {
+        std::perror(opt.output.c_str());
+        return 1;
+    }
+
+    SegmentPipeline pipeline(rate, p, threads, out);
+
+    auto make_segment = [&](uint64_t first) {
+        auto s = std::make_unique<Segment>();
+        s->first_sample = first;
+        s->L.reserve(span);
+        s->R.reserve(span);
+        s->M.reserve(span);
+        return s;
+    };
+    // Next segment starts S hops later and inherits the N - hop overlap
+    auto next_segment = [&](const Segment &prev) {
+        const size_t adv = (size_t)S * p.hop;
+        auto s = make_segment(prev.first_sample + adv);
+        s->L.assign(prev.L.begin() + adv, prev.L.end());
+        s->R.assign(prev.R.begin() + adv, prev.R.end());
+        s->M.assign(prev.M.begin() + adv, prev.M.end());
+        return s;
+    };
+
+    std::unique_ptr<Segment> cur = make_segment(0);
+    uint64_t total_samples = 0;
+    auto push_frame = [&](const int16_t *pcm, int samples, int channels) {
+        split_stereo(pcm, samples, channels, Lf, Rf, Mf);
+        total_samples += samples;
+
+        size_t off = 0;
+        while (off < (size_t)samples)
+        {
+            size_t take = std::min((size_t)samples - off, span - cur->L.size());
+            cur->L.insert(cur->L.end(), Lf + off, Lf + off + take);
+            cur->R.insert(cur->R.end(), Rf + off, Rf + off + take);
+            cur->M.insert(cur->M.end(), Mf + off, Mf + off + take);
+            off += take;
+            if (cur->L.size() == span)
+            {
+                cur->hops = S;
+                auto next = next_segment(*cur);
+                pipeline.submit(std::move(cur));
+                cur = std::move(next);
+            }
+        }
+    };
+
+    // Blocks of frames decoded in parallel, then fed in stream order
+    WorkStealingPool decoders(threads);
+    const size_t block = std::max<size_t>(1024, (size_t)threads * 128);
+    std::vector<int16_t> pcm;
+    std::vector<uint16_t> counts(block);
+    for (size_t first = 0; first < index.size(); first += block)
+    {
+        const size_t last = std::min(index.size(), first + block);
+        pcm.resize(index.pcm_values(first, last));
+        if (!decode_parallel(input->data(), input->size(), index, first, last, decoders, pcm.data(), counts.data()) &&
+            !decode_frames(input->data(), input->size(), index, first, last, 0, pcm.data(), counts.data()))
+        {
+            std::cerr << "MP3 stream does not decode as indexed: " << opt.input << '\n';
+            pipeline.finish();
+            return 1;
+        }
+        for (size_t i = first; i < last; ++i)
+            if (counts[i - first] > 0)
+                push_frame(pcm.data() + (index[i].pcm - index[first].pcm), counts[i - first], index[i].channels);
+        if (last < index.size())
+            input->release(index[index.warmup_start(last)].offset);
+    }
+    if (cur->L.size() >= (size_t)p.N)
+    {
+        cur->hops = (int)((cur->L.size() - p.N) / p.hop + 1);
+        pipeline.submit(std::move(cur));
+    }
+    pipeline.finish();
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count();
+    double audio_sec = double(total_samples) / rate;
+    std::fprintf(stderr, "%s: %.1f s of audio, %llu hops, %llu circles in %.2f s (%.1fx realtime, %d threads)\n",
+                 opt.input.c_str(), audio_sec, (unsigned long long)pipeline.hops(),
+                 (unsigned long long)pipeline.events(), elapsed, audio_sec / std::max(elapsed, 1e-9), threads);
+    return 0;
+}
+
+FileStats analyze_stream(const std::string &path, const AnalysisParams &p, HopSink &sink, bool track_partials)
+{
+    const auto t_start = std::chrono::steady_clock::now();
+    FileStats st;
+    st.input = path;
+
+    std::unique_ptr<MappedFile> input;
+    try
+    {
+        input = std::make_unique<MappedFile>(path);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << '\n';
+        return st;
+    }
+    const int rate = probe_rate(*input);
+    if (rate <= 0)
+    {
+        std::cerr << "No MP3 frames in: " << path << '\n';
+        return st;
+    }
+    if (!sink.begin(rate))
+        return st;
+
+    mp3dec_t dec;
+    mp3dec_init(&dec);
+    mp3dec_frame_info_t info{};
+    int16_t pcm[MINIMP3_MAX_SAMPLES_PER_FRAME];
+    float Lf[MINIMP3_MAX_SAMPLES_PER_FRAME], Rf[MINIMP3_MAX_SAMPLES_PER_FRAME], Mf[MINIMP3_MAX_SAMPLES_PER_FRAME];
+
+    HopAnalyzer analyzer(rate, p);
+    const size_t ring_cap = p.N + MINIMP3_MAX_SAMPLES_PER_FRAME;
+    SampleRing<float> left_ring(ring_cap, p.N), right_ring(ring_cap, p.N), mid_ring(ring_cap, p.N);
+    std::vector<CircleEvent> events;
+    uint64_t total_samples = 0;
+    uint64_t hop_sample = 0;
+
+    std::unique_ptr<PartialTracker> tracker;
+    std::vector<CircleEvent> hop_events;
+    if (track_partials)
+        tracker = make_partial_tracker(rate, p);
+
+    size_t pos = 0;
+    while (pos < input->size())
+    {
+        int samples = mp3dec_decode_frame(&dec, input->data() + pos, (int)(input->size() - pos), pcm, &info);
+        if (info.frame_bytes <= 0)
+            break;
+        pos += info.frame_bytes;
+        input->release(pos);
+        if (samples <= 0)
+            continue;
+
+        split_stereo(pcm, samples, info.channels, Lf, Rf, Mf);
+        total_samples += samples;
+        left_ring.push(Lf, samples);
+        right_ring.push(Rf, samples);
+        mid_ring.push(Mf, samples);
+
+        while (mid_ring.size() >= (size_t)p.N)
+        {
+            events.clear();
+            HopFeatures f = analyzer.analyze(left_ring.peek(), right_ring.peek(), mid_ring.peek(), hop_sample, events);
+            if (tracker)
+            {
+                // Re-struck notes centred before this hop's window go first
+                hop_events.clear();
+                tracker->take(hop_sample + p.N / 2, hop_events);
+                tracker->track(events);
+                hop_events.insert(hop_events.end(), events.begin(), events.end());
+                events.swap(hop_events);
+            }
+            sink.hop(f, events.data(), (uint32_t)events.size());
+            st.hops++;
+            st.events += events.size();
+            hop_sample += p.hop;
+            left_ring.consume(p.hop);
+            right_ring.consume(p.hop);
+            mid_ring.consume(p.hop);
+        }
+
+        if (tracker && mid_ring.size() >= (size_t)tracker->window())
+        {
+            size_t lead = mid_ring.size() - tracker->window();
+            tracker->update(mid_ring.peek() + lead, hop_sample + lead);
+        }
+    }
+    if (tracker)
+    {
+        events.clear();
+        tracker->take(UINT64_MAX, events);
+        sink.tail(events.data(), (uint32_t)events.size());
+        st.events += events.size();
+    }
+
+    st.ok = true;
+    st.audio_sec = double(total_samples) / rate;
+    st.wall_sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count();
+    return st;
+}
+
+FileStats analyze_file(const std::string &path, const std::string &output, const AnalysisParams &p)
+{
+    struct WriterSink : HopSink
+    {
+        const std::string &output;
+        const AnalysisParams &p;
+        std::unique_ptr<FeatureWriter> out;
+
+        WriterSink(const std::string &o, const AnalysisParams &params) : output(o), p(params) {}
+
+        bool begin(int rate) override
+        {
+            out = std::make_unique<FeatureWriter>(output, rate, p);
+            if (!out->ok())
+                std::perror(output.c_str());
+            return out->ok();
+        }
+
+        void hop(const HopFeatures &f, const CircleEvent *events, uint32_t count) override
+        {
+            out->write(f, events, count);
+        }
+    } sink(output, p);
+    return analyze_stream(path, p, sink);
+}
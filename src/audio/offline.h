@@ -0,0 +1,61 @@
+#ifndef OFFLINE_H
+#define OFFLINE_H
+
+#include <string>
+
+#include "analysis.h"
+
+// Headless analysis: no window, no playback.
+// The decoded stream is cut into segments of segment_hops hops; consecutive
+// segments overlap by N - hop samples so every hop sees its full window.
+// Segments are analyzed on a pool of threads and written back in order.
+// Decoding is parallel too: the stream is indexed first (see Mp3Index) and
+// decoded in chunks of frames, with the same PCM as a sequential pass.
+struct OfflineOptions
+{
+    std::string input;
+    std::string output;      // see FeatureWriter
+    int threads = 0;         // 0 = one per hardware thread
+    int segment_hops = 64;   // hops per work unit
+    bool keep_index = false; // load / save the frame index at Mp3Index::index_path(input)
+    AnalysisParams params;
+};
+
+// Returns a process exit code
+int run_offline(const OfflineOptions &opt);
+
+// Outcome of one single-threaded file analysis
+struct FileStats
+{
+    std::string input;
+    bool ok = false;
+    double audio_sec = 0.0;
+    double wall_sec = 0.0;
+    uint64_t hops = 0;
+    uint64_t events = 0;
+};
+
+// Receives the results of analyze_stream, in hop order
+class HopSink
+{
+public:
+    virtual ~HopSink() = default;
+    // Called once the sample rate is known; false aborts the analysis
+    virtual bool begin(int rate) { (void)rate; return true; }
+    // With partial tracking, events start with the notes re-struck since the
+    // previous hop (window of PartialTracker::window() samples)
+    virtual void hop(const HopFeatures &f, const CircleEvent *events, uint32_t count) = 0;
+    // Re-struck notes still held after the last hop
+    virtual void tail(const CircleEvent *events, uint32_t count) { (void)events; (void)count; }
+};
+
+// Decode and analyze one file on the calling thread, streaming through
+// fixed rings (memory does not grow with the file). track_partials runs a
+// PartialTracker between hops exactly as the live path does.
+FileStats analyze_stream(const std::string &input, const AnalysisParams &params, HopSink &sink,
+                         bool track_partials = false);
+
+// analyze_stream into a FeatureWriter on output
+FileStats analyze_file(const std::string &input, const std::string &output, const AnalysisParams &params);
+
+#endif
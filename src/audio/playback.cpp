@@ -0,0 +1,108 @@
+#include <algorithm>
+
+#include "playback.h"
+#include "../stats.h"
+
+namespace
+{
+
+const size_t kChannels = 2;
+
+size_t ring_samples(const AudioSink &sink, int rate, double buffer_sec)
+{
+    size_t frames = std::max((size_t)(buffer_sec * rate), 2 * sink.chunk_frames());
+    return frames * kChannels;
+}
+
+} // namespace
+
+Playback::Playback(AudioSink &sink, int rate, double buffer_sec, SampleClock *clock)
+    : sink_(sink), clock_(clock), chunk_samples_(sink.chunk_frames() * kChannels),
+      ring_(ring_samples(sink, rate, buffer_sec), sink.chunk_frames() * kChannels)
+{
+    thread_ = std::thread([this] { run(); });
+}
+
+Playback::~Playback() { finish(); }
+
+bool Playback::write(const int16_t *pcm, size_t frames)
+{
+    // Every push and consume is a whole number of frames and the capacity is
+    // a power of two, so the free space is always a whole number of frames
+    size_t left = frames * kChannels;
+    while (left > 0)
+    {
+        if (failed_.load(std::memory_order_acquire))
+            return false;
+        size_t n = ring_.push(pcm, left);
+        if (n == 0)
+        {
+            uint32_t seq = drained_.load(std::memory_order_acquire);
+            if (ring_.free_space() == 0 && !failed_.load(std::memory_order_acquire))
+                drained_.wait(seq, std::memory_order_acquire);
+            continue;
+        }
+        pcm += n;
+        left -= n;
+        filled_.fetch_add(1, std::memory_order_release);
+        filled_.notify_one();
+    }
+    return true;
+}
+
+void Playback::finish()
+{
+    if (!thread_.joinable())
+        return;
+    done_.store(true, std::memory_order_release);
+    filled_.fetch_add(1, std::memory_order_release);
+    filled_.notify_one();
+    thread_.join();
+    sink_.close();
+}
+
+void Playback::run()
+{
+    bool started = false;
+    uint64_t written = 0; // frames handed to the sink
+    for (;;)
+    {
+        size_t avail = ring_.size();
+        if (avail == 0)
+        {
+            uint32_t seq = filled_.load(std::memory_order_acquire);
+            if (ring_.size() != 0)
+                continue;
+            if (done_.load(std::memory_order_acquire))
+                break;
+            // Decoder fell behind the sink; the device lives on what it has buffered
+            if (started)
+                stats().playback_starved.fetch_add(1, std::memory_order_relaxed);
+            filled_.wait(seq, std::memory_order_acquire);
+            continue;
+        }
+
+        // Straight from the ring: up to a chunk is contiguous thanks to the mirror
+        size_t n = std::min(avail, chunk_samples_);
+        if (clock_)
+        {
+            // Anchor before the write: the chunk may play while write() blocks
+            size_t delay = std::min<size_t>(sink_.delay_frames(), written);
+            clock_->publish(written - delay, written + n / kChannels, SampleClock::now_ns());
+        }
+        bool ok;
+        {
+            SYN_TIME(Stage::SinkWrite);
+            ok = sink_.write(ring_.peek(), n / kChannels);
+        }
+        ring_.consume(n);
+        started = true;
+        written += n / kChannels;
+        if (!ok)
+            failed_.store(true, std::memory_order_release);
+        drained_.fetch_add(1, std::memory_order_release);
+        drained_.notify_one();
+        if (!ok)
+            break;
+    }
+}
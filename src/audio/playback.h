@@ -0,0 +1,50 @@
+#ifndef PLAYBACK_H
+#define PLAYBACK_H
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#include "clock.h"
+#include "ring_buffer.h"
+#include "sink.h"
+
+// Plays interleaved stereo PCM on a dedicated thread.
+//
+// The decoder pushes into a lock-free ring and the playback thread drains it
+// into the sink in chunk_frames() batches, so a slow hop of analysis only
+// shrinks the buffered lead instead of stalling the device. The producer
+// blocks only when the ring is full, which paces decoding at the sink's rate.
+class Playback
+{
+public:
+    // sink must already be open; buffer_sec of audio is queued ahead at most.
+    // clock, if given, is advanced as the sink consumes frames.
+    Playback(AudioSink &sink, int rate, double buffer_sec = 0.5, SampleClock *clock = nullptr);
+    ~Playback();
+
+    Playback(const Playback &) = delete;
+    Playback &operator=(const Playback &) = delete;
+
+    // Producer: queue frames, blocking while the ring is full.
+    // Returns false once the sink has failed (the frames are dropped).
+    bool write(const int16_t *pcm, size_t frames);
+
+    // Let everything queued play out, then close the sink
+    void finish();
+
+private:
+    void run();
+
+    AudioSink &sink_;
+    SampleClock *clock_;
+    size_t chunk_samples_;
+    SampleRing<int16_t> ring_;
+    std::atomic<uint32_t> filled_{0};  // bumped by the producer after each push
+    std::atomic<uint32_t> drained_{0}; // bumped by the playback thread after each write
+    std::atomic<bool> done_{false};
+    std::atomic<bool> failed_{false};
+    std::thread thread_;
+};
+
+#endif
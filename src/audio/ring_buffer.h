@@ -0,0 +1,132 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <algorithm>
+#include <type_traits>
+
+constexpr size_t kCacheLine = 64;
+
+inline size_t next_pow2(size_t n)
+{
+    size_t p = 1;
+    while (p < n)
+        p <<= 1;
+    return p;
+}
+
+// Fixed-capacity ring of trivially copyable samples.
+//
+// Capacity is rounded up to a power of two so indices wrap with a mask.
+// The storage is followed by a mirror of its first `window` slots: every write
+// landing in [0, window) is copied to [capacity, capacity + window), so any
+// read of up to `window` samples is contiguous without copying the whole ring.
+//
+// Safe as a lock-free single-producer/single-consumer queue: the producer only
+// moves head_, the consumer only moves tail_ (acquire/release pairs).
+template <typename T>
+class SampleRing
+{
+    static_assert(std::is_trivially_copyable_v<T>, "SampleRing holds raw samples");
+
+public:
+    SampleRing(size_t capacity, size_t window)
+        : cap_(next_pow2(capacity)), mask_(cap_ - 1), window_(std::min(window, cap_))
+    {
+        size_t bytes = (cap_ + window_) * sizeof(T);
+        bytes = (bytes + kCacheLine - 1) / kCacheLine * kCacheLine;
+        data_ = static_cast<T *>(std::aligned_alloc(kCacheLine, bytes));
+        if (!data_)
+            throw std::bad_alloc();
+    }
+
+    ~SampleRing() { std::free(data_); }
+
+    SampleRing(const SampleRing &) = delete;
+    SampleRing &operator=(const SampleRing &) = delete;
+
+    size_t capacity() const { return cap_; }
+    size_t window() const { return window_; }
+
+    // Samples available to the consumer
+    size_t size() const
+    {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_relaxed);
+    }
+
+    // Free slots seen from the producer
+    size_t free_space() const
+    {
+        return cap_ - (head_.load(std::memory_order_relaxed) - tail_.load(std::memory_order_acquire));
+    }
+
+    // Producer: append up to n samples, returns how many were written
+    size_t push(const T *src, size_t n)
+    {
+        size_t head = head_.load(std::memory_order_relaxed);
+        size_t tail = tail_.load(std::memory_order_acquire);
+        n = std::min(n, cap_ - (head - tail));
+        size_t done = 0;
+        while (done < n)
+        {
+            size_t idx = (head + done) & mask_;
+            size_t chunk = std::min(n - done, cap_ - idx);
+            std::memcpy(data_ + idx, src + done, chunk * sizeof(T));
+            if (idx < window_) // keep the mirrored wrap segment in sync
+            {
+                size_t m = std::min(chunk, window_ - idx);
+                std::memcpy(data_ + cap_ + idx, src + done, m * sizeof(T));
+            }
+            done += chunk;
+        }
+        head_.store(head + n, std::memory_order_release);
+        return n;
+    }
+
+    // Consumer: contiguous view of the next window() samples (valid up to size())
+    const T *peek() const
+    {
+        return data_ + (tail_.load(std::memory_order_relaxed) & mask_);
+    }
+
+    // Consumer: pop up to n samples into dst, returns how many were read
+    size_t pop(T *dst, size_t n)
+    {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t head = head_.load(std::memory_order_acquire);
+        n = std::min(n, head - tail);
+        size_t done = 0;
+        while (done < n)
+        {
+            size_t idx = (tail + done) & mask_;
+            size_t chunk = std::min(n - done, cap_ - idx);
+            std::memcpy(dst + done, data_ + idx, chunk * sizeof(T));
+            done += chunk;
+        }
+        tail_.store(tail + n, std::memory_order_release);
+        return n;
+    }
+
+    // Consumer: drop n samples (n <= size())
+    void consume(size_t n)
+    {
+        tail_.store(tail_.load(std::memory_order_relaxed) + n, std::memory_order_release);
+    }
+
+    // Total samples ever consumed (position of peek() in the stream)
+    size_t read_pos() const { return tail_.load(std::memory_order_relaxed); }
+
+private:
+    size_t cap_;
+    size_t mask_;
+    size_t window_;
+    T *data_ = nullptr;
+    alignas(kCacheLine) std::atomic<size_t> head_{0}; // written by the producer
+    alignas(kCacheLine) std::atomic<size_t> tail_{0}; // written by the consumer
+};
+
+#endif
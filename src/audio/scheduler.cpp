@@ -0,0 +1,118 @@
+#include "scheduler.h"
+
+namespace
+{
+// Worker identity, so nested submissions stay local
+thread_local const WorkStealingPool *tls_pool = nullptr;
+thread_local int tls_index = -1;
+} // namespace
+
+WorkStealingPool::WorkStealingPool(int threads)
+{
+    if (threads < 1)
+        threads = 1;
+    for (int i = 0; i < threads; ++i)
+        queues_.push_back(std::make_unique<Queue>());
+    for (int i = 0; i < threads; ++i)
+        threads_.emplace_back([this, i] { run(i); });
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    wait_idle();
+    {
+        std::lock_guard<std::mutex> lk(m_);
+        stop_ = true;
+    }
+    work_cv_.notify_all();
+    for (std::thread &t : threads_)
+        t.join();
+}
+
+void WorkStealingPool::submit(Task task)
+{
+    int target;
+    {
+        std::lock_guard<std::mutex> lk(m_);
+        target = tls_pool == this ? tls_index : (int)(next_++ % queues_.size());
+        ++pending_;
+        ++queued_; // counted before it is visible, so queued_ never underflows
+    }
+    {
+        Queue &q = *queues_[target];
+        std::lock_guard<std::mutex> lk(q.m);
+        q.tasks.push_back(std::move(task));
+    }
+    work_cv_.notify_one();
+}
+
+void WorkStealingPool::wait_idle()
+{
+    std::unique_lock<std::mutex> lk(m_);
+    idle_cv_.wait(lk, [this] { return pending_ == 0; });
+}
+
+uint64_t WorkStealingPool::steals() const
+{
+    std::lock_guard<std::mutex> lk(m_);
+    return steals_;
+}
+
+bool WorkStealingPool::pop_local(int self, Task &out)
+{
+    Queue &q = *queues_[self];
+    std::lock_guard<std::mutex> lk(q.m);
+    if (q.tasks.empty())
+        return false;
+    out = std::move(q.tasks.back());
+    q.tasks.pop_back();
+    return true;
+}
+
+bool WorkStealingPool::steal(int self, Task &out)
+{
+    const int n = (int)queues_.size();
+    for (int k = 1; k < n; ++k)
+    {
+        Queue &q = *queues_[(self + k) % n];
+        std::lock_guard<std::mutex> lk(q.m);
+        if (q.tasks.empty())
+            continue;
+        out = std::move(q.tasks.front());
+        q.tasks.pop_front();
+        return true;
+    }
+    return false;
+}
+
+void WorkStealingPool::run(int self)
+{
+    tls_pool = this;
+    tls_index = self;
+    for (;;)
+    {
+        Task task;
+        bool stolen = false;
+        if (!pop_local(self, task))
+            stolen = steal(self, task);
+        if (task)
+        {
+            {
+                std::lock_guard<std::mutex> lk(m_);
+                --queued_;
+                if (stolen)
+                    ++steals_;
+            }
+            task();
+            std::lock_guard<std::mutex> lk(m_);
+            if (--pending_ == 0)
+                idle_cv_.notify_all();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lk(m_);
+        work_cv_.wait(lk, [this] { return stop_ || queued_ > 0; });
+        if (stop_ && queued_ == 0)
+            return;
+    }
+}
@@ -0,0 +1,62 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Thread pool with one task deque per worker.
+// A worker runs its own deque newest-first (hot caches) and, when it runs dry,
+// steals the oldest task from another worker, so long and short tasks even
+// out across threads without a shared run queue. Tasks submitted from a
+// worker go to that worker's deque; outside submissions are spread round-robin.
+class WorkStealingPool
+{
+public:
+    using Task = std::function<void()>;
+
+    explicit WorkStealingPool(int threads);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool &) = delete;
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+    int size() const { return (int)queues_.size(); }
+
+    void submit(Task task);
+
+    // Block until every submitted task has finished
+    void wait_idle();
+
+    // Tasks taken from another worker's deque so far
+    uint64_t steals() const;
+
+private:
+    struct Queue
+    {
+        std::mutex m;
+        std::deque<Task> tasks;
+    };
+
+    bool pop_local(int self, Task &out);
+    bool steal(int self, Task &out);
+    void run(int self);
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> threads_;
+    size_t next_ = 0; // round-robin target, guarded by m_
+
+    mutable std::mutex m_;
+    std::condition_variable work_cv_; // tasks queued or stopping
+    std::condition_variable idle_cv_; // pending_ dropped to 0
+    size_t queued_ = 0;               // tasks sitting in deques
+    size_t pending_ = 0;              // tasks queued or running
+    uint64_t steals_ = 0;
+    bool stop_ = false;
+};
+
+#endif
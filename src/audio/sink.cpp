@@ -0,0 +1,199 @@
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#include "sink.h"
+#include "player.h"
+#include "../stats.h"
+
+namespace
+{
+
+const int kChannels = 2;
+
+// Pipe a bit larger than the default 64 KiB so aplay rides out a late write;
+// everything in it is audio decoded ahead of the device, on top of the
+// Playback ring (128 KiB is about 0.7 s at 48 kHz). The kernel caps it at
+// /proc/sys/fs/pipe-max-size.
+const int kPipeBytes = 1 << 17;
+
+// Frames per write: a few MP3 frames, well below any useful buffer_sec, so
+// the write granularity never sets the Playback ring size
+const size_t kMaxChunkFrames = 4096;
+
+int64_t now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+void put_u16(std::FILE *f, uint16_t v)
+{
+    uint8_t b[2] = {uint8_t(v), uint8_t(v >> 8)};
+    std::fwrite(b, 1, 2, f);
+}
+
+void put_u32(std::FILE *f, uint32_t v)
+{
+    uint8_t b[4] = {uint8_t(v), uint8_t(v >> 8), uint8_t(v >> 16), uint8_t(v >> 24)};
+    std::fwrite(b, 1, 4, f);
+}
+
+} // namespace
+
+bool AplaySink::open(int rate)
+{
+    rate_ = rate;
+    try
+    {
+        pid_ = start_aplay_process(rate, pipefd_);
+    }
+    catch (const std::exception &)
+    {
+        return false;
+    }
+#ifdef F_SETPIPE_SZ
+    fcntl(pipefd_[1], F_SETPIPE_SZ, kPipeBytes);
+    int bytes = fcntl(pipefd_[1], F_GETPIPE_SZ);
+    if (bytes > 0)
+        chunk_frames_ = std::min(kMaxChunkFrames, (size_t)bytes / (kChannels * sizeof(int16_t)));
+#endif
+    return true;
+}
+
+bool AplaySink::write(const int16_t *pcm, size_t frames)
+{
+    size_t bytes = frames * kChannels * sizeof(int16_t);
+    const uint8_t *p = reinterpret_cast<const uint8_t *>(pcm);
+    while (bytes > 0)
+    {
+        ssize_t n = ::write(pipefd_[1], p, bytes);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            perror("write to aplay");
+            return false;
+        }
+        p += n;
+        bytes -= (size_t)n;
+    }
+    return true;
+}
+
+size_t AplaySink::delay_frames() const
+{
+    int bytes = 0;
+    if (pipefd_[1] == -1 || ioctl(pipefd_[1], FIONREAD, &bytes) != 0)
+        return 0;
+    return (size_t)bytes / (kChannels * sizeof(int16_t));
+}
+
+void AplaySink::close()
+{
+    // Closing the writer signals EOF; aplay exits after draining
+    int64_t closed_ns = now_ns();
+    size_t in_pipe = delay_frames();
+    if (pipefd_[1] != -1)
+    {
+        ::close(pipefd_[1]);
+        pipefd_[1] = -1;
+    }
+    if (pid_ > 0)
+    {
+        int status = 0;
+        waitpid(pid_, &status, 0);
+        if (WIFEXITED(status) && WEXITSTATUS(status) != 0)
+            std::fprintf(stderr, "aplay exited with status %d\n", WEXITSTATUS(status));
+        else if (rate_ > 0)
+        {
+            // Whatever aplay still played past the pipe contents was in its device buffer
+            int64_t drain_us = (now_ns() - closed_ns) / 1000 - (int64_t)(in_pipe * 1000000ull / (uint64_t)rate_);
+            stats().output_latency_us.store(std::max<int64_t>(drain_us, 0), std::memory_order_relaxed);
+        }
+        pid_ = -1;
+    }
+}
+
+bool WavSink::open(int rate)
+{
+    f_ = std::fopen(path_.c_str(), "wb");
+    if (!f_)
+    {
+        std::perror(path_.c_str());
+        return false;
+    }
+    // Sizes are patched in close()
+    std::fwrite("RIFF", 1, 4, f_);
+    put_u32(f_, 0);
+    std::fwrite("WAVEfmt ", 1, 8, f_);
+    put_u32(f_, 16);
+    put_u16(f_, 1); // PCM
+    put_u16(f_, kChannels);
+    put_u32(f_, (uint32_t)rate);
+    put_u32(f_, (uint32_t)rate * kChannels * sizeof(int16_t));
+    put_u16(f_, kChannels * sizeof(int16_t));
+    put_u16(f_, 16);
+    std::fwrite("data", 1, 4, f_);
+    put_u32(f_, 0);
+    return true;
+}
+
+bool WavSink::write(const int16_t *pcm, size_t frames)
+{
+    if (!f_ || std::fwrite(pcm, kChannels * sizeof(int16_t), frames, f_) != frames)
+        return false;
+    frames_ += frames;
+    return true;
+}
+
+void WavSink::close()
+{
+    if (!f_)
+        return;
+    uint32_t data = (uint32_t)(frames_ * kChannels * sizeof(int16_t));
+    std::fseek(f_, 4, SEEK_SET);
+    put_u32(f_, 36 + data);
+    std::fseek(f_, 40, SEEK_SET);
+    put_u32(f_, data);
+    std::fclose(f_);
+    f_ = nullptr;
+}
+
+bool NullSink::open(int rate)
+{
+    rate_ = rate;
+    frames_ = 0;
+    start_ns_ = now_ns();
+    return rate > 0;
+}
+
+bool NullSink::write(const int16_t *, size_t frames)
+{
+    frames_ += frames;
+    // Return once the device would have played everything written
+    int64_t due = start_ns_ + (int64_t)(frames_ * 1000000000ull / (uint64_t)rate_);
+    int64_t wait = due - now_ns();
+    if (wait > 0)
+        std::this_thread::sleep_for(std::chrono::nanoseconds(wait));
+    return true;
+}
+
+std::unique_ptr<AudioSink> make_audio_sink(const std::string &spec)
+{
+    if (spec == "aplay")
+        return std::make_unique<AplaySink>();
+    if (spec == "null")
+        return std::make_unique<NullSink>();
+    if (spec.rfind("wav:", 0) == 0 && spec.size() > 4)
+        return std::make_unique<WavSink>(spec.substr(4));
+    return nullptr;
+}
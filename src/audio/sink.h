@@ -0,0 +1,92 @@
+#ifndef SINK_H
+#define SINK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+
+// Destination of interleaved 16-bit stereo PCM. Only the playback thread
+// talks to a sink, so implementations need no locking.
+class AudioSink
+{
+public:
+    virtual ~AudioSink() = default;
+
+    // Prepare for a stream at rate Hz; false if the sink is unusable
+    virtual bool open(int rate) = 0;
+
+    // Write frames (one frame = L and R sample); blocks at device pace.
+    // Returns false once the sink cannot take more data.
+    virtual bool write(const int16_t *pcm, size_t frames) = 0;
+
+    // Flush and release the device, waiting for queued audio to finish
+    virtual void close() = 0;
+
+    // Frames per write() that keep the device fed without extra syscalls
+    virtual size_t chunk_frames() const { return 4096; }
+
+    // Frames written but not yet handed to the device, as far as the sink knows
+    virtual size_t delay_frames() const { return 0; }
+
+    virtual const char *name() const = 0;
+};
+
+// aplay child process fed through a pipe (the original backend).
+// aplay's own device buffer is invisible from here; close() measures it as
+// the time aplay takes to drain after EOF and records it in the stats.
+class AplaySink : public AudioSink
+{
+public:
+    ~AplaySink() override { close(); }
+    bool open(int rate) override;
+    bool write(const int16_t *pcm, size_t frames) override;
+    void close() override;
+    size_t chunk_frames() const override { return chunk_frames_; }
+    size_t delay_frames() const override; // bytes still in the pipe
+    const char *name() const override { return "aplay"; }
+
+private:
+    int rate_ = 0;
+    int pipefd_[2] = {-1, -1};
+    int pid_ = -1;
+    size_t chunk_frames_ = 4096;
+};
+
+// 16-bit stereo RIFF/WAVE file, written as fast as the disk allows
+class WavSink : public AudioSink
+{
+public:
+    explicit WavSink(std::string path) : path_(std::move(path)) {}
+    ~WavSink() override { close(); }
+    bool open(int rate) override;
+    bool write(const int16_t *pcm, size_t frames) override;
+    void close() override;
+    const char *name() const override { return "wav"; }
+
+private:
+    std::string path_;
+    std::FILE *f_ = nullptr;
+    uint64_t frames_ = 0;
+};
+
+// Discards audio but consumes it at the stream rate, like a sound card would
+class NullSink : public AudioSink
+{
+public:
+    bool open(int rate) override;
+    bool write(const int16_t *pcm, size_t frames) override;
+    void close() override {}
+    const char *name() const override { return "null"; }
+
+private:
+    int rate_ = 0;
+    uint64_t frames_ = 0;
+    int64_t start_ns_ = 0;
+};
+
+// "aplay", "null" or "wav:<path>"; nullptr for anything else
+std::unique_ptr<AudioSink> make_audio_sink(const std::string &spec);
+
+#endif
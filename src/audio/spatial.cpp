@@ -0,0 +1,102 @@
+#include <cmath>
+#include <algorithm>
+#include <numeric>
+#include "spatial.h"
+
+GccPhat::GccPhat(int N, int rate, double f_lo, double f_hi)
+    : N_(N), fwd_(N), inv_(N), re_(N), im_(N), G_(N / 2 + 1), cc_(N)
+{
+    const int Nh = N / 2;
+    k_lo_ = clamp((int)std::ceil(f_lo * N / rate), 0, Nh);
+    k_hi_ = f_hi > 0.0 ? clamp((int)std::floor(f_hi * N / rate), k_lo_, Nh) : Nh;
+}
+
+double GccPhat::lag(const float *L, const float *R, int maxLag)
+{
+    const int N = N_;
+    const int Nh = N / 2;
+    maxLag = std::min(maxLag, Nh - 1);
+
+    const uint32_t *rev = fwd_.bitrev();
+    for (int n = 0; n < N; ++n)
+    {
+        re_[rev[n]] = L[n];
+        im_[rev[n]] = R[n];
+    }
+    fwd_.execute_split(re_.data(), im_.data());
+
+    // Split Z = FFT(L + iR): Lk = (Z[k] + conj(Z[-k])) / 2, Rk = (Z[k] - conj(Z[-k])) / 2i.
+    // Cross-spectrum conj(Lk) * Rk correlates L[n] with R[n + lag]; PHAT keeps its phase only.
+    for (int k = 0; k <= Nh; ++k)
+    {
+        if (k < k_lo_ || k > k_hi_)
+        {
+            G_[k] = cd(0.0, 0.0);
+            continue;
+        }
+        int nk = (N - k) & (N - 1);
+        cd a(re_[k], im_[k]);
+        cd b(re_[nk], -im_[nk]);
+        cd Lk = 0.5 * (a + b);
+        cd Rk = cd(0.0, -0.5) * (a - b);
+        cd C = std::conj(Lk) * Rk;
+        double m = std::abs(C);
+        G_[k] = m > 1e-20 ? C / m : cd(0.0, 0.0);
+    }
+    // Bins 0 and N/2 of a real spectrum have no imaginary part
+    G_[0] = cd(G_[0].real(), 0.0);
+    G_[Nh] = cd(G_[Nh].real(), 0.0);
+
+    inv_.inverse(G_.data(), cc_.data());
+
+    auto at = [&](int lag) { return cc_[(lag + N) & (N - 1)]; };
+    int best = 0;
+    double bestVal = -1e300;
+    for (int l = -maxLag; l <= maxLag; ++l)
+    {
+        double v = at(l);
+        if (v > bestVal)
+        {
+            bestVal = v;
+            best = l;
+        }
+    }
+
+    double m1 = at(best - 1), m0 = bestVal, p1 = at(best + 1);
+    double denom = m1 - 2.0 * m0 + p1;
+    if (std::abs(denom) < 1e-12)
+        return (double)best;
+    double delta = clamp(0.5 * (m1 - p1) / denom, -0.5, 0.5);
+    return (double)best + delta;
+}
+
+SpatialAccumulator::SpatialAccumulator(int N, int hop)
+    : N_(N), hop_(hop), block_(std::gcd(N, hop)), blocks_(N / std::gcd(N, hop))
+{
+}
+
+SpatialSums SpatialAccumulator::update(const float *L, const float *R, uint64_t sample)
+{
+    const size_t nb = blocks_.size();
+    const bool slid = primed_ && sample == next_ && hop_ < N_;
+    const size_t fresh = slid ? (size_t)(hop_ / block_) : nb;
+    if (!slid)
+        head_ = 0;
+    else
+        head_ = (head_ + fresh) % nb;
+
+    // Blocks that entered the window: its last `fresh`
+    for (size_t b = nb - fresh; b < nb; ++b)
+    {
+        SpatialSums &s = blocks_[(head_ + b) % nb];
+        s = SpatialSums{};
+        s.add(L + b * block_, R + b * block_, block_);
+    }
+    primed_ = true;
+    next_ = sample + hop_;
+
+    SpatialSums total;
+    for (size_t b = 0; b < nb; ++b)
+        total += blocks_[(head_ + b) % nb];
+    return total;
+}
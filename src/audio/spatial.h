@@ -3,6 +3,10 @@
 
 #include <cmath>
 #include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "fourier.h"
 
 // Clamp helper
 template <typename T>
@@ -33,6 +37,12 @@ inline double azimuth_from_ild_itd(double ILD_dB, double ITD_sec) {
     return az * 90.0; // degrees: -90° Right to +90° Left
 }
 
+// Width in dB from Mid/Side energies
+inline double width_from_energies(double M2, double S2) {
+    double eps = 1e-20;
+    return 10.0 * std::log10((S2 + eps) / (M2 + eps));
+}
+
 inline double width_from_mid_side(const float* L, const float* R, int N) {
     double M2 = 0.0, S2 = 0.0;
     for (int n = 0; n < N; ++n) {
@@ -41,11 +51,55 @@ inline double width_from_mid_side(const float* L, const float* R, int N) {
         M2 += M * M;
         S2 += S * S;
     }
-    double eps = 1e-20;
-    double width = 10.0 * std::log10((S2 + eps) / (M2 + eps)); // in dB
-    return width;
+    return width_from_energies(M2, S2);
 }
 
+// Second-order sums of a stretch of L/R: what the ILD and the width need
+struct SpatialSums {
+    double L2 = 0.0, R2 = 0.0; // energies
+    double M2 = 0.0, S2 = 0.0; // Mid (L + R) / 2 and Side (L - R) / 2 energies
+
+    // Add n samples, in one pass
+    void add(const float* L, const float* R, int n) {
+        for (int i = 0; i < n; ++i) {
+            double l = L[i], r = R[i];
+            double m = 0.5 * (L[i] + R[i]), s = 0.5 * (L[i] - R[i]); // as width_from_mid_side
+            L2 += l * l;
+            R2 += r * r;
+            M2 += m * m;
+            S2 += s * s;
+        }
+    }
+
+    SpatialSums& operator+=(const SpatialSums& o) {
+        L2 += o.L2; R2 += o.R2; M2 += o.M2; S2 += o.S2;
+        return *this;
+    }
+
+    double width_db() const { return width_from_energies(M2, S2); }
+};
+
+// SpatialSums of an N-sample window sliding by hop, updated with the samples
+// that entered instead of a pass over the whole window. The window is kept as
+// partial sums of gcd(N, hop)-sample blocks; a hop computes only the blocks
+// that entered and re-adds the N / gcd block sums, so nothing is subtracted
+// and the total cannot drift from a direct sum however long the stream runs.
+// A window that did not move by exactly one hop since the last call (first
+// call, seek, another stream) is summed in full.
+class SpatialAccumulator {
+public:
+    SpatialAccumulator(int N, int hop);
+
+    // L, R: the N samples of the window starting at sample
+    SpatialSums update(const float* L, const float* R, uint64_t sample);
+
+private:
+    int N_, hop_, block_;
+    std::vector<SpatialSums> blocks_; // ring, oldest at head_
+    size_t head_ = 0;
+    uint64_t next_ = 0;               // window start that continues the stream
+    bool primed_ = false;
+};
 
 // Cross-correlation (coarse) to get ITD lag within +/- maxLag samples.
 // Returns lag where R matches L best: positive lag means R is delayed w.r.t. L.
@@ -73,4 +127,30 @@ inline int xcorr_argmax_lag(const float* L, const float* R, int N, int maxLag) {
     return bestLag;
 }
 
-#endif
\ No newline at end of file
+// Generalized cross-correlation with phase transform (GCC-PHAT).
+// L and R are transformed together in one N-point complex FFT (L + iR),
+// the cross-spectrum is whitened to unit magnitude, optionally restricted to
+// [f_lo, f_hi], and brought back with one real inverse FFT. Cost is
+// O(N log N) per call whatever maxLag is.
+class GccPhat {
+public:
+    // f_hi <= 0 means up to Nyquist
+    GccPhat(int N, int rate, double f_lo = 0.0, double f_hi = 0.0);
+
+    int size() const { return N_; }
+
+    // Fractional lag in +/- maxLag samples, parabolic peak interpolation.
+    // Same convention as xcorr_argmax_lag: positive lag means R is delayed w.r.t. L.
+    double lag(const float* L, const float* R, int maxLag);
+
+private:
+    int N_;
+    int k_lo_, k_hi_;
+    FftPlan fwd_;
+    RealFft inv_;
+    std::vector<double> re_, im_; // packed L + iR, split
+    std::vector<cd> G_;           // whitened cross-spectrum, bins 0..N/2
+    std::vector<double> cc_;      // circular cross-correlation
+};
+
+#endif
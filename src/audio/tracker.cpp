@@ -0,0 +1,98 @@
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+#include "tracker.h"
+#include "../stats.h"
+
+namespace
+{
+
+// Level in dBFS of the Goertzel bin for coefficient c over n Hann-windowed
+// samples, scaled like the FFT path (|X| / (n / 2))
+double goertzel_db(const float *x, int n, double c)
+{
+    double s1 = 0.0, s2 = 0.0;
+    for (int i = 0; i < n; ++i)
+    {
+        double s0 = x[i] + c * s1 - s2;
+        s2 = s1;
+        s1 = s0;
+    }
+    double power = s1 * s1 + s2 * s2 - c * s1 * s2;
+    return 10.0 * std::log10(std::max(power, 1e-30)) - 20.0 * std::log10(n * 0.5);
+}
+
+} // namespace
+
+PartialTracker::PartialTracker(int rate, int window, int harmonics, double thresh_db)
+    : rate_(rate), W_(window), harmonics_(std::min(harmonics, kMaxPartials - 1)), thresh_db_(thresh_db),
+      hann_(window), xw_(window), timbre_(kMaxPartials)
+{
+    for (int n = 0; n < W_; ++n)
+        hann_[n] = float(0.5 * (1.0 - std::cos(2.0 * std::numbers::pi * n / (W_ - 1))));
+}
+
+void PartialTracker::track(const std::vector<CircleEvent> &hop_events)
+{
+    notes_.clear();
+    for (const CircleEvent &e : hop_events)
+    {
+        Note note;
+        note.base = e;
+        note.min_db = e.db;
+        note.partials = 0;
+        for (int h = 1; h <= harmonics_ + 1 && h * e.freq < rate_ / 2.0; ++h)
+            note.coeff[note.partials++] = 2.0 * std::cos(2.0 * std::numbers::pi * h * e.freq / rate_);
+        if (note.partials > 0)
+            notes_.push_back(note);
+    }
+}
+
+void PartialTracker::update(const float *M, uint64_t sample)
+{
+    if (notes_.empty())
+        return;
+    SYN_TIME(Stage::Track);
+    for (int n = 0; n < W_; ++n)
+        xw_[n] = M[n] * hann_[n];
+
+    size_t kept = 0;
+    for (size_t i = 0; i < notes_.size(); ++i)
+    {
+        Note &note = notes_[i];
+        double db = goertzel_db(xw_.data(), W_, note.coeff[0]);
+        if (db < thresh_db_)
+            continue; // note ended
+
+        if (db - note.min_db >= kReattackDb)
+        {
+            timbre_[0] = db;
+            for (int h = 1; h < note.partials; ++h)
+                timbre_[h] = goertzel_db(xw_.data(), W_, note.coeff[h]);
+            CircleEvent e = circle_from_timbre(note.base.freq, db, std::span(timbre_).first(note.partials), sample,
+                                               (uint32_t)W_);
+            e.radius = note.base.radius; // harmonic count is only known from the full spectrum
+            held_.push_back(e);
+            note.min_db = db;
+        }
+        note.min_db = std::min(note.min_db, db);
+        if (kept != i)
+            notes_[kept] = note;
+        ++kept;
+    }
+    notes_.resize(kept);
+}
+
+void PartialTracker::take(uint64_t before, std::vector<CircleEvent> &events)
+{
+    size_t i = 0;
+    while (i < held_.size() && held_[i].sample + held_[i].span / 2 < before)
+        events.push_back(held_[i++]);
+    held_.erase(held_.begin(), held_.begin() + i);
+}
+
+std::unique_ptr<PartialTracker> make_partial_tracker(int rate, const AnalysisParams &p)
+{
+    return std::make_unique<PartialTracker>(rate, std::min(2048, p.N - p.hop), 8, p.peak_thresh_db);
+}
@@ -0,0 +1,65 @@
+#ifndef TRACKER_H
+#define TRACKER_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "analysis.h"
+
+// Follows the partials found by the last full FFT between hops.
+//
+// track() takes the circles of a hop; every update() then measures each
+// fundamental and its first `harmonics` harmonics on the newest window()
+// samples with Hann-windowed Goertzel filters (O(partials) per sample, no
+// FFT). A note whose level jumps by kReattackDb over its quietest point since
+// it was last shown is struck again: a circle is emitted with the current
+// level and fullness, so repeated notes show up within one decoded frame
+// instead of waiting for the next hop. Notes that fall below the threshold
+// are dropped until a full FFT finds them again.
+class PartialTracker
+{
+public:
+    static constexpr double kReattackDb = 6.0;
+    static constexpr int kMaxPartials = 16; // fundamental + harmonics per note
+
+    PartialTracker(int rate, int window = 2048, int harmonics = 8, double thresh_db = kPeakThreshDb);
+
+    int window() const { return W_; }
+    size_t notes() const { return notes_.size(); }
+
+    // Replace the tracked notes with the partials of a full analysis
+    void track(const std::vector<CircleEvent> &hop_events);
+
+    // M holds window() samples starting at stream position sample
+    void update(const float *M, uint64_t sample);
+
+    // Move re-struck circles centred before `before` to events, in order
+    void take(uint64_t before, std::vector<CircleEvent> &events);
+
+private:
+    struct Note
+    {
+        CircleEvent base;           // circle from the full analysis
+        double coeff[kMaxPartials]; // 2 cos(w) per partial, fundamental first
+        int partials;
+        double min_db;              // quietest fundamental since last shown
+    };
+
+    int rate_;
+    int W_;
+    int harmonics_;
+    double thresh_db_;
+    std::vector<float> hann_;
+    std::vector<float> xw_;
+    std::vector<double> timbre_; // kMaxPartials slots
+    std::vector<Note> notes_;
+    std::vector<CircleEvent> held_;
+};
+
+// The tracker run beside a HopAnalyzer with parameters p, by the live path
+// and by the feature cache alike. Its window fits in the N - hop samples the
+// rings keep after a hop, so it is updated on every frame whatever the FFT size.
+std::unique_ptr<PartialTracker> make_partial_tracker(int rate, const AnalysisParams &p);
+
+#endif
@@ -0,0 +1,100 @@
+#include <cstring>
+
+#include "wav.h"
+
+namespace
+{
+
+// Little-endian fields; WAV is little-endian like every target we build for
+uint16_t u16(const uint8_t *p)
+{
+    uint16_t v;
+    std::memcpy(&v, p, 2);
+    return v;
+}
+
+uint32_t u32(const uint8_t *p)
+{
+    uint32_t v;
+    std::memcpy(&v, p, 4);
+    return v;
+}
+
+const uint16_t kFormatPcm = 1, kFormatFloat = 3, kFormatExtensible = 0xFFFE;
+
+} // namespace
+
+bool parse_wav(const uint8_t *data, size_t size, WavFormat &fmt)
+{
+    if (size < 12 || std::memcmp(data, "RIFF", 4) != 0 || std::memcmp(data + 8, "WAVE", 4) != 0)
+        return false;
+
+    bool have_fmt = false;
+    size_t pos = 12;
+    while (pos + 8 <= size)
+    {
+        const uint8_t *chunk = data + pos;
+        const size_t len = u32(chunk + 4);
+        const size_t body = pos + 8;
+        if (std::memcmp(chunk, "fmt ", 4) == 0 && len >= 16 && body + len <= size)
+        {
+            uint16_t tag = u16(chunk + 8);
+            fmt.channels = u16(chunk + 10);
+            fmt.rate = (int)u32(chunk + 12);
+            fmt.bits = u16(chunk + 22);
+            if (tag == kFormatExtensible && len >= 40)
+            {
+                fmt.channel_mask = u32(chunk + 28);
+                tag = u16(chunk + 32); // first two bytes of the SubFormat GUID
+            }
+            fmt.is_float = tag == kFormatFloat;
+            if (tag != kFormatPcm && tag != kFormatFloat)
+                return false;
+            have_fmt = true;
+        }
+        else if (std::memcmp(chunk, "data", 4) == 0 && have_fmt)
+        {
+            // A streamed file may carry a data length past the end
+            if (fmt.channels <= 0 || fmt.rate <= 0 || fmt.frame_bytes() == 0)
+                return false;
+            fmt.data_offset = body;
+            fmt.frames = (len < size - body ? len : size - body) / fmt.frame_bytes();
+            break;
+        }
+        pos = body + len + (len & 1); // chunks are padded to even sizes
+    }
+    if (!have_fmt || fmt.data_offset == 0)
+        return false;
+    if (fmt.is_float)
+        return fmt.bits == 32;
+    return fmt.bits == 16 || fmt.bits == 24 || fmt.bits == 32;
+}
+
+void wav_to_float(const WavFormat &fmt, const uint8_t *pcm, size_t frames, float *out)
+{
+    const size_t n = frames * fmt.channels;
+    if (fmt.is_float)
+    {
+        std::memcpy(out, pcm, n * sizeof(float));
+        return;
+    }
+    switch (fmt.bits)
+    {
+    case 16:
+        for (size_t i = 0; i < n; ++i)
+            out[i] = float(int16_t(u16(pcm + 2 * i))) * (1.0f / 32768.0f);
+        break;
+    case 24:
+        for (size_t i = 0; i < n; ++i)
+        {
+            const uint8_t *p = pcm + 3 * i;
+            int32_t v = int32_t(uint32_t(p[0]) << 8 | uint32_t(p[1]) << 16 | uint32_t(p[2]) << 24) >> 8;
+            out[i] = float(v) * (1.0f / 8388608.0f);
+        }
+        break;
+    default:
+        for (size_t i = 0; i < n; ++i)
+            out[i] = float(int32_t(u32(pcm + 4 * i))) * (1.0f / 2147483648.0f);
+        break;
+    }
+}
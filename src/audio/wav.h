@@ -0,0 +1,29 @@
+#ifndef WAV_H
+#define WAV_H
+
+#include <cstddef>
+#include <cstdint>
+
+// PCM layout of a RIFF/WAVE file: integer 16/24/32-bit or float32 samples,
+// any number of interleaved channels, WAVE_FORMAT_EXTENSIBLE included.
+struct WavFormat
+{
+    int rate = 0;
+    int channels = 0;
+    int bits = 0;              // per sample
+    bool is_float = false;
+    uint32_t channel_mask = 0; // speaker positions (SPEAKER_* bits), 0 if not given
+    size_t data_offset = 0;    // first byte of PCM
+    size_t frames = 0;
+
+    size_t frame_bytes() const { return (size_t)channels * (bits / 8); }
+};
+
+// Reads the header of a WAV file held in memory (e.g. a MappedFile view);
+// false if it is not a WAV file this reader handles
+bool parse_wav(const uint8_t *data, size_t size, WavFormat &fmt);
+
+// `frames` frames of PCM at pcm, as interleaved float in [-1, 1)
+void wav_to_float(const WavFormat &fmt, const uint8_t *pcm, size_t frames, float *out);
+
+#endif
@@ -1,26 +1,194 @@
 #include <string>
+#include <cstdio>
+#include <cstdlib>
 #include <thread>
 #include <iostream>
 #include <sys/wait.h>
 
 #include "audio/audio.h"
+#include "audio/batch.h"
+#include "audio/input.h"
+#include "audio/multichannel.h"
+#include "audio/offline.h"
+#include "visual/video.h"
 #include "visual/visual.h"
 #include "shared_state.h"
+#include "stats.h"
+
+static void usage(const char *prog)
+{
+    std::fprintf(stderr,
+                 "Usage: %s [options] <file.mp3>\n"
+                 "  --offline <out>   analyze without window or playback, write features to <out>\n"
+                 "                    (*.csv for text, anything else for binary, - for stdout)\n"
+                 "  --threads <n>     worker threads for --offline/--batch (default: all cores)\n"
+                 "  --mp3-index       keep the frame index of --offline next to the input (<file>.mp3.idx)\n"
+                 "  --no-cache        always analyze live, ignore and do not build the feature cache\n"
+                 "  --multires        short windows above 500 Hz (~11 ms updates), long ones for bass\n"
+                 "  --no-track        do not follow partials between analysis hops\n"
+                 "  --double          double-precision spectrum (reference; float32 by default)\n"
+                 "  --fft-size <n>    analysis window, power of 2 (default: 16384, hop n/4)\n"
+                 "  --trails          keep a decaying trail instead of redrawing live circles\n"
+                 "  --sink <spec>     audio output: aplay (default), null (discard at realtime pace),\n"
+                 "                    wav:<file> (write as fast as possible)\n"
+                 "  --av-offset <ms>  delay circles by the output latency the sink cannot see\n"
+                 "                    (measured value is printed at exit as output_latency_ms)\n"
+                 "  --stats <file>    rewrite <file> every second with stage latencies and counters\n"
+                 "\n"
+                 "       %s --render <out> [options] <file.mp3>\n"
+                 "  render to video offscreen, as fast as possible (- for stdout)\n"
+                 "  --size <w>x<h>        frame size (default: 1920x1080)\n"
+                 "  --fps <n>             frame rate (default: 60)\n"
+                 "  --video-format <fmt>  y4m (default) or rgba (raw frames)\n"
+                 "\n"
+                 "       %s --spatial <out.csv> [--ambisonic] <file.wav>\n"
+                 "  direction, levels and per-pair ILD/ITD of an N-channel WAV (- for stdout)\n"
+                 "  --ambisonic           channels are first-order AmbiX (W Y Z X), not speakers\n"
+                 "\n"
+                 "       %s --batch <dir|manifest> --out-dir <dir> [options]\n"
+                 "  --format <bin|csv>    feature file format (default: bin)\n"
+                 "  --max-inflight <n>    files open at once (default: 2 per thread)\n",
+                 prog,
+                 prog,
+                 prog,
+                 prog);
+}
 
 int main(int argc, char **argv)
 {
-    if (argc < 2)
+    std::string file;
+    std::string offline_out;
+    VideoOptions video;
+    SpatialOptions spatial;
+    int threads = 0;
+    bool keep_index = false;
+    BatchOptions batch;
+    AudioOptions audio_opt;
+    VisualOptions visual_opt;
+    std::string stats_path;
+    double av_offset_ms = 0.0;
+    for (int i = 1; i < argc; ++i)
     {
-        std::fprintf(stderr, "Usage: %s <file.mp3>\n", argv[0]);
+        std::string arg = argv[i];
+        if (arg == "--offline" && i + 1 < argc)
+            offline_out = argv[++i];
+        else if (arg == "--render" && i + 1 < argc)
+            video.output = argv[++i];
+        else if (arg == "--size" && i + 1 < argc)
+        {
+            if (std::sscanf(argv[++i], "%dx%d", &video.width, &video.height) != 2)
+            {
+                usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (arg == "--fps" && i + 1 < argc)
+            video.fps = std::atoi(argv[++i]);
+        else if (arg == "--video-format" && i + 1 < argc)
+            video.format = argv[++i];
+        else if (arg == "--spatial" && i + 1 < argc)
+            spatial.output = argv[++i];
+        else if (arg == "--ambisonic")
+            spatial.ambisonic = true;
+        else if (arg == "--threads" && i + 1 < argc)
+            threads = std::atoi(argv[++i]);
+        else if (arg == "--mp3-index")
+            keep_index = true;
+        else if (arg == "--no-cache")
+            audio_opt.use_cache = false;
+        else if (arg == "--multires")
+            audio_opt.multires = true;
+        else if (arg == "--no-track")
+            audio_opt.track_partials = false;
+        else if (arg == "--trails")
+            visual_opt.trails = true;
+        else if (arg == "--double")
+            audio_opt.single_precision = false;
+        else if (arg == "--fft-size" && i + 1 < argc)
+        {
+            int n = std::atoi(argv[++i]);
+            if (n < 256 || (n & (n - 1)) != 0)
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            audio_opt.fft_size = n;
+        }
+        else if (arg == "--sink" && i + 1 < argc)
+            audio_opt.sink = argv[++i];
+        else if (arg == "--av-offset" && i + 1 < argc)
+            av_offset_ms = std::atof(argv[++i]);
+        else if (arg == "--stats" && i + 1 < argc)
+            stats_path = argv[++i];
+        else if (arg == "--batch" && i + 1 < argc)
+            batch.source = argv[++i];
+        else if (arg == "--out-dir" && i + 1 < argc)
+            batch.out_dir = argv[++i];
+        else if (arg == "--format" && i + 1 < argc)
+            batch.format = argv[++i];
+        else if (arg == "--max-inflight" && i + 1 < argc)
+            batch.max_inflight = std::atoi(argv[++i]);
+        else if (arg.rfind("--", 0) == 0)
+        {
+            usage(argv[0]);
+            return 1;
+        }
+        else
+            file = arg;
+    }
+    StatsExporter exporter(stats_path, std::chrono::milliseconds(1000));
+
+    if (!batch.source.empty())
+    {
+        if (batch.out_dir.empty())
+        {
+            usage(argv[0]);
+            return 1;
+        }
+        batch.threads = threads;
+        apply_analysis_options(batch.params, audio_opt);
+        return run_batch(batch);
+    }
+    if (file.empty())
+    {
+        usage(argv[0]);
         return 1;
     }
-    const std::string path = "assets/" + std::string(argv[1]);
+    const std::string path = resolve_input_path(file);
+
+    if (!spatial.output.empty())
+    {
+        spatial.input = path;
+        return run_spatial(spatial);
+    }
+
+    if (!video.output.empty())
+    {
+        video.input = path;
+        apply_analysis_options(video.params, audio_opt);
+        video.trails = visual_opt.trails;
+        return render_video(video);
+    }
+
+    if (!offline_out.empty())
+    {
+        OfflineOptions opt;
+        opt.input = path;
+        opt.output = offline_out;
+        opt.threads = threads;
+        opt.keep_index = keep_index;
+        apply_analysis_options(opt.params, audio_opt);
+        return run_offline(opt);
+    }
 
     SharedState shared;
-    std::thread audio_thread_handle(audio_thread, path, &shared);
-    std::thread visual_thread_handle(visual_thread, &shared);
+    shared.av_offset_sec = av_offset_ms / 1000.0;
+    std::thread audio_thread_handle(audio_thread, path, &shared, audio_opt);
+    std::thread visual_thread_handle(visual_thread, &shared, visual_opt);
     audio_thread_handle.join();
     visual_thread_handle.join();
 
+    stats_write(stderr);
+
     return 0;
 }
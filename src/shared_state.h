@@ -1,36 +1,41 @@
 #ifndef SHARED_STATE_H
 #define SHARED_STATE_H
 
-#include <mutex>
 #include <atomic>
+#include <cstdint>
 #include <GLFW/glfw3.h>
-#include <vector>
 
 #include "visual/circle.h"
+#include "audio/clock.h"
+#include "audio/ring_buffer.h"
+#include "stats.h"
 
+// Circles travel from the audio thread to the render thread through a
+// wait-free SPSC queue: the producer never blocks, the renderer never allocates.
+// Each circle carries its sample position and stays queued until the playback
+// clock says that sample is audible.
 struct SharedState {
-    std::vector<Circle> circles;
-    std::mutex mtx;
+    SampleRing<Circle> circle_events{kCircleQueueSize, 0};
+    SampleClock clock;          // audible frame, published by the playback thread
+    double av_offset_sec = 0.0; // extra output latency not seen by the clock (set before start)
     std::atomic<bool> running{true};
 };
 
-// Thread-safe helper to add a circle to shared state
-inline void add_circle_shared(SharedState *shared, float ux, float uy, float radius = 0.05f, float falloff = 1.4f, float intensity = 1.0f)
+// Thread-safe helper to add a circle to shared state (single producer)
+inline void add_circle_shared(SharedState *shared, float ux, float uy, float radius = 0.05f, float falloff = 1.4f, float intensity = 1.0f,
+                              uint64_t sample = 0)
 {
     Circle c;
     c.x = ux;
     c.y = uy;
-    // don't call glfwGetTime() from the flux thread; set t0=0 and let the drawing
-    // thread initialize it to the correct time when it copies the list.
-    c.t0 = 0.0;
+    c.sample = sample;
     c.radius = radius;
     c.falloff = falloff;
     c.intensity = intensity;
 
-    std::lock_guard<std::mutex> lk(shared->mtx);
-    if (shared->circles.size() >= (size_t)kMaxCircles)
-        shared->circles.erase(shared->circles.begin());
-    shared->circles.push_back(c);
+    SYN_TIME(Stage::CirclePush);
+    if (shared->circle_events.push(&c, 1) == 0)
+        stats().circles_dropped.fetch_add(1, std::memory_order_relaxed);
 }
 
 // Backwards-compatible: add circle using the GLFW window's user pointer (if it points to SharedState)
@@ -0,0 +1,279 @@
+#ifndef STATS_H
+#define STATS_H
+
+// Hot-path instrumentation: scoped stage timers feeding lock-free latency
+// histograms, plus counters for missed deadlines. Everything is process-wide
+// and safe to record from any thread.
+//
+// Build with SYN_NO_STATS (CMake: -DTT_ENABLE_STATS=OFF) to compile the
+// timers out entirely; the counters and exporter then report zeros.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+
+enum class Stage
+{
+    Decode,      // mp3dec_decode_frame
+    Window,      // Hann window of the Mid signal
+    Fft,         // real FFT
+    Magnitude,   // |X| and dBFS conversion
+    Peaks,       // peaks_selector
+    Timbre,      // timbre_harmonics for every peak
+    Spatial,     // energy, ILD, ITD, width
+    Hop,         // whole analysis of one hop
+    Track,       // PartialTracker update between hops
+    SinkWrite,   // playback thread writing a chunk to the audio sink
+    CirclePush,  // audio thread handing circles to the renderer
+    CircleDrain, // render thread taking them
+    Render,      // frame setup + draw call
+    Swap,        // glfwSwapBuffers
+    Count
+};
+
+inline const char *stage_name(Stage s)
+{
+    static const char *names[] = {"decode", "window", "fft", "magnitude", "peaks", "timbre", "spatial",
+                                  "hop", "track", "sink_write", "circle_push", "circle_drain", "render", "swap"};
+    return names[(int)s];
+}
+
+// Log-linear histogram of nanosecond latencies (HDR-style: 8 sub-buckets per
+// power of two, so any reported value is within 12.5% of the true one).
+// record() is a few relaxed atomic adds and never blocks.
+class LatencyHistogram
+{
+public:
+    static constexpr int kLinear = 16;
+    static constexpr int kSub = 8;
+    static constexpr int kBuckets = kLinear + (64 - 4) * kSub;
+
+    void record(uint64_t ns)
+    {
+        counts_[bucket(ns)].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(ns, std::memory_order_relaxed);
+        uint64_t m = max_.load(std::memory_order_relaxed);
+        while (ns > m && !max_.compare_exchange_weak(m, ns, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+    double mean() const
+    {
+        uint64_t n = count();
+        return n ? double(sum_.load(std::memory_order_relaxed)) / double(n) : 0.0;
+    }
+
+    // Upper bound of the bucket holding quantile q (0..1)
+    uint64_t percentile(double q) const
+    {
+        uint64_t n = count();
+        if (n == 0)
+            return 0;
+        uint64_t target = (uint64_t)(q * double(n - 1)) + 1;
+        uint64_t seen = 0;
+        for (int i = 0; i < kBuckets; ++i)
+        {
+            seen += counts_[i].load(std::memory_order_relaxed);
+            if (seen >= target)
+                return std::min(upper(i), max());
+        }
+        return max();
+    }
+
+private:
+    static int bucket(uint64_t v)
+    {
+        if (v < (uint64_t)kLinear)
+            return (int)v;
+        int e = 63 - __builtin_clzll(v); // >= 4
+        int m = (int)((v >> (e - 3)) & (kSub - 1));
+        return kLinear + (e - 4) * kSub + m;
+    }
+
+    static uint64_t upper(int i)
+    {
+        if (i < kLinear)
+            return (uint64_t)i;
+        int e = (i - kLinear) / kSub + 4;
+        int m = (i - kLinear) % kSub;
+        return ((uint64_t)(kSub + m + 1) << (e - 3)) - 1;
+    }
+
+    std::atomic<uint64_t> counts_[kBuckets] = {};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> max_{0};
+};
+
+struct Stats
+{
+    LatencyHistogram stage[(int)Stage::Count];
+    std::atomic<uint64_t> hops_behind_realtime{0}; // hop analysis slower than the hop duration
+    std::atomic<uint64_t> frames_over_budget{0};   // frame interval above 1.5 vsync periods
+    std::atomic<uint64_t> playback_starved{0};     // playback ring ran empty mid-stream
+    std::atomic<uint64_t> circles_dropped{0};      // circle queue full
+    std::atomic<uint64_t> circles_evicted{0};      // live list full at kMaxCircles
+    std::atomic<int64_t> output_latency_us{-1};    // device buffer measured by the sink, -1 if unknown
+};
+
+inline Stats &stats()
+{
+    static Stats s;
+    return s;
+}
+
+inline uint64_t stats_now_ns()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// Stage timers on the calling thread stop recording while one of these is
+// alive, for background work (the feature cache builder) that runs the same
+// code as the realtime path but must not skew its latencies
+inline bool &stats_muted()
+{
+    thread_local bool muted = false;
+    return muted;
+}
+
+class StatsMute
+{
+public:
+    StatsMute() : prev_(stats_muted()) { stats_muted() = true; }
+    ~StatsMute() { stats_muted() = prev_; }
+    StatsMute(const StatsMute &) = delete;
+    StatsMute &operator=(const StatsMute &) = delete;
+
+private:
+    bool prev_;
+};
+
+#ifndef SYN_NO_STATS
+class ScopedTimer
+{
+public:
+    explicit ScopedTimer(Stage s) : s_(s), t0_(stats_now_ns()) {}
+    ~ScopedTimer() { stop(); }
+
+    // Record now instead of at scope exit
+    void stop()
+    {
+        if (!done_ && !stats_muted())
+            stats().stage[(int)s_].record(stats_now_ns() - t0_);
+        done_ = true;
+    }
+
+    // Nanoseconds since construction
+    uint64_t elapsed() const { return stats_now_ns() - t0_; }
+
+private:
+    Stage s_;
+    uint64_t t0_;
+    bool done_ = false;
+};
+#define SYN_CONCAT_(a, b) a##b
+#define SYN_CONCAT(a, b) SYN_CONCAT_(a, b)
+#define SYN_TIME(stage) ScopedTimer SYN_CONCAT(syn_timer_, __LINE__)(stage)
+#else
+class ScopedTimer
+{
+public:
+    explicit ScopedTimer(Stage) {}
+    void stop() {}
+    uint64_t elapsed() const { return 0; }
+};
+#define SYN_TIME(stage) ((void)0)
+#endif
+
+inline void stats_write(std::FILE *f)
+{
+    Stats &s = stats();
+    std::fprintf(f, "%-13s %10s %10s %10s %10s %10s %10s (us)\n", "stage", "count", "mean", "p50", "p99",
+                 "p99.9", "max");
+    for (int i = 0; i < (int)Stage::Count; ++i)
+    {
+        const LatencyHistogram &h = s.stage[i];
+        if (h.count() == 0)
+            continue;
+        std::fprintf(f, "%-13s %10llu %10.1f %10.1f %10.1f %10.1f %10.1f\n", stage_name((Stage)i),
+                     (unsigned long long)h.count(), h.mean() / 1e3, h.percentile(0.5) / 1e3,
+                     h.percentile(0.99) / 1e3, h.percentile(0.999) / 1e3, h.max() / 1e3);
+    }
+    std::fprintf(f, "hops_behind_realtime %llu\n", (unsigned long long)s.hops_behind_realtime.load());
+    std::fprintf(f, "frames_over_budget %llu\n", (unsigned long long)s.frames_over_budget.load());
+    std::fprintf(f, "playback_starved %llu\n", (unsigned long long)s.playback_starved.load());
+    std::fprintf(f, "circles_dropped %llu\n", (unsigned long long)s.circles_dropped.load());
+    std::fprintf(f, "circles_evicted %llu\n", (unsigned long long)s.circles_evicted.load());
+    if (int64_t us = s.output_latency_us.load(); us >= 0)
+        std::fprintf(f, "output_latency_ms %.1f (pass as --av-offset)\n", us / 1e3);
+}
+
+// Rewrites path with the current stats every period (temporary file + rename,
+// so readers never see a partial file) until destroyed
+class StatsExporter
+{
+public:
+    StatsExporter(std::string path, std::chrono::milliseconds period)
+        : path_(std::move(path)), period_(period)
+    {
+        if (!path_.empty())
+            thread_ = std::thread([this] { run(); });
+    }
+
+    ~StatsExporter()
+    {
+        {
+            std::lock_guard<std::mutex> lk(m_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        if (thread_.joinable())
+            thread_.join();
+    }
+
+    StatsExporter(const StatsExporter &) = delete;
+    StatsExporter &operator=(const StatsExporter &) = delete;
+
+private:
+    void write_once()
+    {
+        std::string tmp = path_ + ".tmp";
+        std::FILE *f = std::fopen(tmp.c_str(), "w");
+        if (!f)
+            return;
+        stats_write(f);
+        std::fclose(f);
+        std::rename(tmp.c_str(), path_.c_str());
+    }
+
+    void run()
+    {
+        std::unique_lock<std::mutex> lk(m_);
+        while (!stop_)
+        {
+            cv_.wait_for(lk, period_, [this] { return stop_; });
+            write_once();
+        }
+    }
+
+    std::string path_;
+    std::chrono::milliseconds period_;
+    std::mutex m_;
+    std::condition_variable cv_;
+    bool stop_ = false;
+    std::thread thread_;
+};
+
+#endif
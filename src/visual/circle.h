@@ -1,19 +1,22 @@
 #ifndef CIRCLE_H
 #define CIRCLE_H
 
+#include <cstdint>
+
+// A circle on its way from the audio thread to the render thread, which
+// stamps its birth time when the sample is heard (see CircleStore)
 struct Circle
 {
     float x, y;
-    double t0;
+    uint64_t sample; // stream position of the sound it depicts (render when heard)
     float radius;   // main circle radius in UV
     float falloff;  // radial falloff exponent
     float intensity; // overall intensity/alpha multiplier
 };
 
 
-const int kMaxCircles = 128;
+const int kMaxCircles = 4096; // power of two (CircleStore ring)
 const double kCircleLife = 1; // seconds
-
-
+const int kCircleQueueSize = 4096; // pending events between audio and render threads
 
 #endif
\ No newline at end of file
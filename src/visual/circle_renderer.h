@@ -0,0 +1,106 @@
+#ifndef CIRCLE_RENDERER_H
+#define CIRCLE_RENDERER_H
+
+#include <glad/glad.h>
+#include <memory>
+
+#include "circle.h"
+#include "circle_store.h"
+#include "loader.h"
+#include "stream_buffer.h"
+
+// The circle program and its per-frame buffer: draws the live circles of a
+// CircleStore into whatever framebuffer is bound. Shared by the window and
+// the video export so both produce the same picture. Needs a current context.
+class CircleRenderer
+{
+public:
+    CircleRenderer()
+    {
+        prog_ = LoadShaderProgram("src/shaders/circle.vert", "src/shaders/circle.frag");
+        glGenVertexArrays(1, &vao_);
+
+        // Uniform locations
+        locLife_ = glGetUniformLocation(prog_, "uLife");
+        locNow_ = glGetUniformLocation(prog_, "uNow");
+        locStride_ = glGetUniformLocation(prog_, "uStride");
+        locAspect_ = glGetUniformLocation(prog_, "uAspect");
+        locRadius_ = glGetUniformLocation(prog_, "uRadius");
+        locDotSpacing_ = glGetUniformLocation(prog_, "uDotSpacing");
+        locDotRadius_ = glGetUniformLocation(prog_, "uDotRadius");
+
+        // Columns of the live circles as the GPU sees them (SSBO binding 0)
+        instances_ = std::make_unique<StreamBuffer>(kColumnBytes, 0);
+    }
+
+    ~CircleRenderer()
+    {
+        instances_.reset();
+        glDeleteVertexArrays(1, &vao_);
+        glDeleteProgram(prog_);
+    }
+
+    CircleRenderer(const CircleRenderer &) = delete;
+    CircleRenderer &operator=(const CircleRenderer &) = delete;
+
+    // Clear the w x h viewport and draw the circles of store as of now
+    // (seconds, the clock their births are on)
+    void draw(const CircleStore &store, float now, int w, int h)
+    {
+        glViewport(0, 0, w, h);
+
+        // Black background
+        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        splat(store, now, w, h);
+    }
+
+    // Draw the circles of store over what the w x h viewport already holds
+    void splat(const CircleStore &store, float now, int w, int h)
+    {
+        // Overlapping circles keep the brightest dot, as the old per-pixel loop did
+        glEnable(GL_BLEND);
+        glBlendEquation(GL_MAX);
+        glBlendFunc(GL_ONE, GL_ONE);
+
+        // Columns go to this frame's slice as they are; ages are computed on the GPU
+        const int count = (int)store.size();
+        store.copy_columns(static_cast<float *>(instances_->begin()));
+
+        glUseProgram(prog_);
+        glUniform1f(locLife_, float(kCircleLife));
+        glUniform1f(locNow_, now);
+        glUniform1i(locStride_, CircleStore::kCapacity);
+        glUniform1f(locAspect_, h > 0 ? float(w) / float(h) : 1.0f);
+        // set dotted-circle params (tweak these to taste)
+        float radius = 0.05f;      // main circle radius in UV
+        float dotSpacing = 0.001f; // spacing between dots in UV
+        float dotRadius = 0.0005f; // small dot radius in UV
+        if (locRadius_ >= 0)
+            glUniform1f(locRadius_, radius);
+        if (locDotSpacing_ >= 0)
+            glUniform1f(locDotSpacing_, dotSpacing);
+        if (locDotRadius_ >= 0)
+            glUniform1f(locDotRadius_, dotRadius);
+
+        // One quad (4-vertex strip) per circle
+        glBindVertexArray(vao_);
+        if (count > 0)
+        {
+            instances_->bind(kColumnBytes);
+            glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+        }
+        instances_->end();
+    }
+
+private:
+    static constexpr size_t kColumnBytes = CircleStore::kColumns * CircleStore::kCapacity * sizeof(float);
+
+    GLuint prog_ = 0;
+    GLuint vao_ = 0;
+    GLint locLife_, locNow_, locStride_, locAspect_;
+    GLint locRadius_, locDotSpacing_, locDotRadius_;
+    std::unique_ptr<StreamBuffer> instances_;
+};
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef CIRCLE_STORE_H
+#define CIRCLE_STORE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#include "circle.h"
+
+// Live circles in birth order, structure-of-arrays: one float column per
+// attribute in a fixed power-of-two ring. Every circle lives kCircleLife, so
+// the oldest is always the first to expire: expiry is a head advance and
+// adding to a full store evicts the head. The column layout is what
+// shaders/circle.vert reads, so a frame's upload is one copy per column.
+class CircleStore
+{
+public:
+    enum Column
+    {
+        kX,
+        kY,
+        kRadius,
+        kFalloff,
+        kIntensity,
+        kBirth, // seconds on the render clock; age is computed on the GPU
+        kColumns
+    };
+    static constexpr uint32_t kCapacity = kMaxCircles;
+    static_assert((kCapacity & (kCapacity - 1)) == 0, "kMaxCircles must be a power of two");
+
+    uint32_t size() const { return tail_ - head_; }
+
+    // Add a circle born at `birth`. Births are clamped to the newest one so the
+    // ring stays sorted. Returns false if the oldest circle had to be evicted.
+    bool push(const Circle &c, float birth)
+    {
+        bool evicted = size() == kCapacity;
+        if (evicted)
+            ++head_;
+        birth = std::max(birth, newest_);
+        newest_ = birth;
+        uint32_t i = tail_++ & kMask;
+        col_[kX][i] = c.x;
+        col_[kY][i] = c.y;
+        col_[kRadius][i] = c.radius;
+        col_[kFalloff][i] = c.falloff;
+        col_[kIntensity][i] = c.intensity;
+        col_[kBirth][i] = birth;
+        return !evicted;
+    }
+
+    // Drop every circle
+    void clear() { head_ = tail_; }
+
+    // Drop circles born at or before now - life
+    void expire(float now, float life)
+    {
+        while (head_ != tail_ && now - col_[kBirth][head_ & kMask] >= life)
+            ++head_;
+    }
+
+    // Live circles, oldest first, into dst: kColumns columns of kCapacity
+    // floats each, the first size() entries of every column filled
+    void copy_columns(float *dst) const
+    {
+        uint32_t n = size(), first = head_ & kMask;
+        uint32_t run = std::min(n, kCapacity - first); // up to the end of the ring
+        for (int c = 0; c < kColumns; ++c)
+        {
+            float *out = dst + (size_t)c * kCapacity;
+            std::memcpy(out, &col_[c][first], run * sizeof(float));
+            std::memcpy(out + run, &col_[c][0], (n - run) * sizeof(float));
+        }
+    }
+
+private:
+    static constexpr uint32_t kMask = kCapacity - 1;
+
+    float col_[kColumns][kCapacity];
+    uint32_t head_ = 0, tail_ = 0; // free-running, index with & kMask
+    float newest_ = -std::numeric_limits<float>::infinity();
+};
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <glad/glad.h>
+#include <cstdio>
+#include <cstdlib>
+
+#ifdef SYN_HAVE_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#else
+#include <GLFW/glfw3.h>
+#endif
+
+// A current OpenGL context with no window, for rendering into FBOs.
+// With EGL it is surfaceless (EGL_MESA_platform_surfaceless when offered, so
+// no display server is needed; Mesa falls back to llvmpipe on hosts without
+// a GPU, or always with LIBGL_ALWAYS_SOFTWARE=1). Without EGL it is a hidden
+// GLFW window. Asks for 4.6 core and settles for 4.5, llvmpipe's ceiling.
+class HeadlessContext
+{
+public:
+    HeadlessContext()
+    {
+#ifdef SYN_HAVE_EGL
+        auto get_platform_display =
+            (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (get_platform_display)
+            dpy_ = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        if (dpy_ == EGL_NO_DISPLAY)
+            dpy_ = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        EGLint major, minor;
+        if (dpy_ == EGL_NO_DISPLAY || !eglInitialize(dpy_, &major, &minor) || !eglBindAPI(EGL_OPENGL_API))
+            fail("EGL initialization failed");
+
+        for (EGLint gl_minor : {6, 5})
+        {
+            const EGLint attribs[] = {EGL_CONTEXT_MAJOR_VERSION, 4, EGL_CONTEXT_MINOR_VERSION, gl_minor,
+                                      EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                                      EGL_NONE};
+            ctx_ = eglCreateContext(dpy_, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attribs);
+            if (ctx_ != EGL_NO_CONTEXT)
+                break;
+        }
+        if (ctx_ == EGL_NO_CONTEXT || !eglMakeCurrent(dpy_, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx_))
+            fail("No surfaceless OpenGL 4.5 context");
+        if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress))
+            fail("Failed to initialize GLAD");
+#else
+        if (!glfwInit())
+            fail("glfwInit failed");
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        for (int gl_minor : {6, 5})
+        {
+            glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, gl_minor);
+            if ((win_ = glfwCreateWindow(16, 16, "Export", nullptr, nullptr)))
+                break;
+        }
+        if (!win_)
+            fail("glfwCreateWindow failed");
+        glfwMakeContextCurrent(win_);
+        if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+            fail("Failed to initialize GLAD");
+#endif
+        std::fprintf(stderr, "GL_VERSION  : %s\n", glGetString(GL_VERSION));
+        std::fprintf(stderr, "GL_RENDERER : %s\n", glGetString(GL_RENDERER));
+    }
+
+    ~HeadlessContext()
+    {
+#ifdef SYN_HAVE_EGL
+        eglMakeCurrent(dpy_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(dpy_, ctx_);
+        eglTerminate(dpy_);
+#else
+        glfwDestroyWindow(win_);
+        glfwTerminate();
+#endif
+    }
+
+    HeadlessContext(const HeadlessContext &) = delete;
+    HeadlessContext &operator=(const HeadlessContext &) = delete;
+
+private:
+    [[noreturn]] static void fail(const char *what)
+    {
+        std::fprintf(stderr, "%s\n", what);
+        std::exit(1);
+    }
+
+#ifdef SYN_HAVE_EGL
+    EGLDisplay dpy_ = EGL_NO_DISPLAY;
+    EGLContext ctx_ = EGL_NO_CONTEXT;
+#else
+    GLFWwindow *win_ = nullptr;
+#endif
+};
+
+#endif
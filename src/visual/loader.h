@@ -8,7 +8,7 @@
 #include <GLFW/glfw3.h>
 
 
-static std::string readFile(const std::string& path) {
+inline std::string readFile(const std::string& path) {
     std::ifstream file(path);
     if (!file.is_open()) {
         throw std::runtime_error("Failed to open file: " + path);
@@ -18,7 +18,7 @@ static std::string readFile(const std::string& path) {
     return buffer.str();
 }
 
-GLuint LoadShaderProgram(const std::string& vertexPath, const std::string& fragmentPath) {
+inline GLuint LoadShaderProgram(const std::string& vertexPath, const std::string& fragmentPath) {
     // Read source
     std::string vertCode = readFile(vertexPath);
     std::string fragCode = readFile(fragmentPath);
@@ -1,10 +1,40 @@
-#version 460 core
-// Full-screen triangle generated from gl_VertexID.
-// Pass normalized UV (0..1) to the fragment shader.
-out vec2 vUV;
+#version 450 core
+// One screen-space quad per circle: a 4-vertex triangle strip drawn instanced,
+// sized to the circle radius plus one dot so only covered pixels are shaded.
+// Circle attributes come from the SSBO written by visual_thread.
+
+// Structure-of-arrays, as CircleStore keeps it: column k of circle i is
+// col[k * uStride + i], k in x, y, radius, falloff, intensity, birth.
+layout(std430, binding = 0) readonly buffer Circles {
+    float col[];
+};
+
+uniform int uStride;      // floats per column
+uniform float uNow;       // render clock, seconds; births are on the same clock
+uniform float uAspect;    // framebuffer width / height; radii are in units of the height
+uniform float uRadius;    // default main circle radius in UV
+uniform float uDotRadius; // radius of each small dot in UV
+
+out vec2 vRel;              // offset from the circle centre in UV
+flat out float vRadius;
+flat out float vFalloff;
+flat out float vIntensity;
+flat out float vAge;
+
 void main() {
-    // A full-screen triangle that covers the viewport.
-    const vec2 verts[3] = vec2[3](vec2(-1.0, -1.0), vec2(3.0, -1.0), vec2(-1.0, 3.0));
-    gl_Position = vec4(verts[gl_VertexID], 0.0, 1.0);
-    vUV = gl_Position.xy * 0.5 + 0.5; // convert clip-space (-1..1) to UV (0..1)
+    int i = gl_InstanceID;
+    vec2 pos = vec2(col[i], col[uStride + i]);
+    float radius = col[2 * uStride + i];     // main circle radius in UV, <= 0 for uRadius
+    float falloff = col[3 * uStride + i];    // radial falloff exponent, <= 0 for the default
+    float intensity = col[4 * uStride + i];  // overall intensity/alpha multiplier, <= 0 for 1
+    vRadius = radius > 0.0 ? radius : uRadius;
+    vFalloff = falloff > 0.0 ? falloff : 1.4;
+    vIntensity = intensity > 0.0 ? intensity : 1.0;
+    vAge = uNow - col[5 * uStride + i];      // seconds since the circle became audible
+
+    // corners (-1,-1), (1,-1), (-1,1), (1,1)
+    vec2 corner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1)) * 2.0 - 1.0;
+    vRel = corner * (vRadius + uDotRadius);
+    vec2 uv = pos + vRel * vec2(1.0 / uAspect, 1.0); // round on any aspect
+    gl_Position = vec4(uv * 2.0 - 1.0, 0.0, 1.0); // UV (0..1) to clip space (-1..1)
 }
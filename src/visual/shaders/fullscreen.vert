@@ -0,0 +1,7 @@
+#version 450 core
+// One triangle covering the viewport, from gl_VertexID alone (draw 3 vertices)
+
+void main() {
+    vec2 p = vec2(float((gl_VertexID << 1) & 2), float(gl_VertexID & 2)); // (0,0) (2,0) (0,2)
+    gl_Position = vec4(p * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -0,0 +1,11 @@
+#version 450 core
+// The trail texture scaled by uGain, pixel for pixel: into the other trail
+// texture with uGain < 1 (decay), onto the screen as grey with uGain = 1.
+uniform sampler2D uTrail;
+uniform float uGain;
+out vec4 fragColor;
+
+void main() {
+    float v = texelFetch(uTrail, ivec2(gl_FragCoord.xy), 0).r * uGain;
+    fragColor = vec4(vec3(v), 1.0);
+}
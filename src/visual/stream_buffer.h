@@ -0,0 +1,81 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+
+// Persistently mapped, triple-buffered shader storage buffer for per-frame
+// data. The CPU writes slice N while the GPU may still read slices N-1 and
+// N-2; a fence per slice makes begin() wait only if the GPU is a full three
+// frames behind. No glBufferSubData or map/unmap per frame.
+class StreamBuffer
+{
+public:
+    static constexpr int kSlices = 3;
+
+    // Room for `bytes` per frame, bound at SSBO binding point `binding`
+    StreamBuffer(size_t bytes, GLuint binding) : binding_(binding)
+    {
+        GLint align = 256;
+        glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &align);
+        slice_ = (bytes + align - 1) / align * align;
+
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glGenBuffers(1, &buf_);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buf_);
+        glBufferStorage(GL_SHADER_STORAGE_BUFFER, kSlices * slice_, nullptr, flags);
+        base_ = static_cast<char *>(glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, kSlices * slice_, flags));
+        if (!base_)
+        {
+            std::fprintf(stderr, "glMapBufferRange failed for the circle buffer\n");
+            std::exit(1);
+        }
+    }
+
+    ~StreamBuffer()
+    {
+        for (GLsync &f : fences_)
+            if (f)
+                glDeleteSync(f);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buf_);
+        glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
+        glDeleteBuffers(1, &buf_);
+    }
+
+    StreamBuffer(const StreamBuffer &) = delete;
+    StreamBuffer &operator=(const StreamBuffer &) = delete;
+
+    // Next slice to fill, once the GPU is done with it
+    void *begin()
+    {
+        cur_ = (cur_ + 1) % kSlices;
+        if (GLsync f = fences_[cur_])
+        {
+            glClientWaitSync(f, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+            glDeleteSync(f);
+            fences_[cur_] = nullptr;
+        }
+        return base_ + cur_ * slice_;
+    }
+
+    // Bind the first `bytes` of the current slice for the next draw
+    void bind(size_t bytes) const
+    {
+        glBindBufferRange(GL_SHADER_STORAGE_BUFFER, binding_, buf_, cur_ * slice_, bytes ? bytes : 1);
+    }
+
+    // After the draws that read the current slice
+    void end() { fences_[cur_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0); }
+
+private:
+    GLuint buf_ = 0;
+    GLuint binding_;
+    size_t slice_;
+    char *base_ = nullptr;
+    int cur_ = kSlices - 1;
+    GLsync fences_[kSlices] = {};
+};
+
+#endif
@@ -0,0 +1,118 @@
+#ifndef TRAIL_RENDERER_H
+#define TRAIL_RENDERER_H
+
+#include <glad/glad.h>
+#include <algorithm>
+#include <cmath>
+
+#include "circle_renderer.h"
+#include "circle_store.h"
+#include "loader.h"
+
+// Incremental rendering: the picture persists in an accumulation texture
+// instead of being redrawn from every live circle. Each frame the texture is
+// copied into its twin scaled by a decay factor (ping-pong), only the circles
+// released since the last frame are splatted on top, and the result is shown.
+// Frame cost follows the new circles and the pixel count, not how many are
+// still visible, so neither kMaxCircles nor kCircleLife bounds the picture.
+//
+// Decay is exponential, down to 1/256 (below one 8-bit step) after `life`
+// seconds; the live mode's fade is linear over kCircleLife, so trails keep
+// the same extent but a softer tail. The texture is R16F: 8 bits would stall
+// at small values, where rounding undoes the decay.
+class TrailRenderer
+{
+public:
+    explicit TrailRenderer(double life) : life_(life)
+    {
+        prog_ = LoadShaderProgram("src/shaders/fullscreen.vert", "src/shaders/trail.frag");
+        glGenVertexArrays(1, &vao_);
+        locTrail_ = glGetUniformLocation(prog_, "uTrail");
+        locGain_ = glGetUniformLocation(prog_, "uGain");
+    }
+
+    ~TrailRenderer()
+    {
+        release();
+        glDeleteVertexArrays(1, &vao_);
+        glDeleteProgram(prog_);
+    }
+
+    TrailRenderer(const TrailRenderer &) = delete;
+    TrailRenderer &operator=(const TrailRenderer &) = delete;
+
+    // Advance the trail by dt seconds, add the circles of fresh as of now and
+    // show the trail in the framebuffer bound on entry, w x h. A new size
+    // starts a new (black) trail.
+    void draw(CircleRenderer &circles, const CircleStore &fresh, float now, float dt, int w, int h)
+    {
+        GLint target = 0;
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &target);
+        if (w != w_ || h != h_)
+            resize(w, h);
+
+        glUseProgram(prog_);
+        glUniform1i(locTrail_, 0);
+        glActiveTexture(GL_TEXTURE0);
+        glBindVertexArray(vao_);
+        glViewport(0, 0, w, h);
+        glDisable(GL_BLEND);
+
+        // Decay into the other texture, then splat the new circles there
+        const int next = 1 - cur_;
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo_[next]);
+        glBindTexture(GL_TEXTURE_2D, tex_[cur_]);
+        glUniform1f(locGain_, float(std::exp2(-8.0 * std::max(dt, 0.0f) / life_)));
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        if (fresh.size() > 0)
+            circles.splat(fresh, now, w, h);
+        cur_ = next;
+
+        // Show it
+        glBindFramebuffer(GL_FRAMEBUFFER, target);
+        glUseProgram(prog_);
+        glBindVertexArray(vao_);
+        glDisable(GL_BLEND);
+        glBindTexture(GL_TEXTURE_2D, tex_[cur_]);
+        glUniform1f(locGain_, 1.0f);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+
+private:
+    void resize(int w, int h)
+    {
+        release();
+        w_ = w;
+        h_ = h;
+        glGenTextures(2, tex_);
+        glGenFramebuffers(2, fbo_);
+        for (int i = 0; i < 2; ++i)
+        {
+            glBindTexture(GL_TEXTURE_2D, tex_[i]);
+            glTexStorage2D(GL_TEXTURE_2D, 1, GL_R16F, w, h);
+            glBindFramebuffer(GL_FRAMEBUFFER, fbo_[i]);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex_[i], 0);
+            glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+        }
+    }
+
+    void release()
+    {
+        if (!tex_[0])
+            return;
+        glDeleteFramebuffers(2, fbo_);
+        glDeleteTextures(2, tex_);
+        tex_[0] = tex_[1] = fbo_[0] = fbo_[1] = 0;
+    }
+
+    double life_;
+    GLuint prog_ = 0;
+    GLuint vao_ = 0;
+    GLint locTrail_, locGain_;
+    GLuint tex_[2] = {}, fbo_[2] = {};
+    int cur_ = 0; // texture holding the trail
+    int w_ = 0, h_ = 0;
+};
+
+#endif
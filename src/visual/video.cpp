@@ -0,0 +1,339 @@
+#include <glad/glad.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "video.h"
+#include "circle.h"
+#include "circle_renderer.h"
+#include "circle_store.h"
+#include "headless.h"
+#include "trail_renderer.h"
+#include "offline.h"
+#include "../stats.h"
+
+namespace
+{
+
+// Frames to a file or stdout for an external encoder, e.g.
+//   ffmpeg -i out.y4m ...   or   ffmpeg -f rawvideo -pix_fmt rgba -s WxH -r FPS -i out.rgba ...
+class FrameWriter
+{
+public:
+    explicit FrameWriter(const VideoOptions &opt)
+        : y4m_(opt.format == "y4m"), w_(opt.width), h_(opt.height)
+    {
+        f_ = opt.output == "-" ? stdout : std::fopen(opt.output.c_str(), "wb");
+        if (!f_)
+            return;
+        if (y4m_)
+        {
+            // Full-range BT.601, chroma subsampled 2x2
+            std::fprintf(f_, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", w_, h_, opt.fps);
+            yuv_.resize((size_t)w_ * h_ * 3 / 2);
+        }
+    }
+
+    ~FrameWriter()
+    {
+        if (f_ && f_ != stdout)
+            std::fclose(f_);
+        else if (f_)
+            std::fflush(f_);
+    }
+
+    bool ok() const { return f_ && !std::ferror(f_); }
+
+    // One w x h RGBA frame, bottom row first as glReadPixels returns it
+    bool write(const uint8_t *rgba)
+    {
+        const size_t row = (size_t)w_ * 4;
+        if (!y4m_)
+        {
+            for (int y = h_ - 1; y >= 0; --y)
+                std::fwrite(rgba + y * row, 1, row, f_);
+            return ok();
+        }
+
+        uint8_t *Y = yuv_.data();
+        uint8_t *U = Y + (size_t)w_ * h_;
+        uint8_t *V = U + (size_t)(w_ / 2) * (h_ / 2);
+        for (int y = 0; y < h_; y += 2)
+        {
+            // Output rows y and y + 1 are source rows h - 1 - y and h - 2 - y
+            const uint8_t *s0 = rgba + (h_ - 1 - y) * row;
+            const uint8_t *s1 = s0 - row;
+            uint8_t *y0 = Y + (size_t)y * w_, *y1 = y0 + w_;
+            uint8_t *u = U + (size_t)(y / 2) * (w_ / 2), *v = V + (size_t)(y / 2) * (w_ / 2);
+            for (int x = 0; x < w_; x += 2)
+            {
+                const uint8_t *p[4] = {s0 + 4 * x, s0 + 4 * x + 4, s1 + 4 * x, s1 + 4 * x + 4};
+                int r = 0, g = 0, b = 0;
+                for (int k = 0; k < 4; ++k)
+                {
+                    r += p[k][0], g += p[k][1], b += p[k][2];
+                    uint8_t luma = uint8_t((77 * p[k][0] + 150 * p[k][1] + 29 * p[k][2] + 128) >> 8);
+                    (k < 2 ? y0 : y1)[x + (k & 1)] = luma;
+                }
+                // r, g, b are 4x the 2x2 average: fold the /4 into the shift
+                u[x / 2] = uint8_t(((-43 * r - 85 * g + 128 * b + 512) >> 10) + 128);
+                v[x / 2] = uint8_t(((128 * r - 107 * g - 21 * b + 512) >> 10) + 128);
+            }
+        }
+        std::fputs("FRAME\n", f_);
+        std::fwrite(yuv_.data(), 1, yuv_.size(), f_);
+        return ok();
+    }
+
+private:
+    FILE *f_ = nullptr;
+    bool y4m_;
+    int w_, h_;
+    std::vector<uint8_t> yuv_; // Y, then U, then V planes
+};
+
+// Offscreen RGBA8 target and a ring of pixel pack buffers. Frame f is copied
+// into buffer f % kReadbacks and mapped kReadbacks - 1 frames later, so the
+// CPU never waits on the frame the GPU is still drawing.
+class Readback
+{
+public:
+    static constexpr int kReadbacks = 3;
+
+    Readback(int w, int h) : w_(w), h_(h), bytes_((size_t)w * h * 4)
+    {
+        glGenFramebuffers(1, &fbo_);
+        glGenRenderbuffers(1, &color_);
+        glBindRenderbuffer(GL_RENDERBUFFER, color_);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, w, h);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo_);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color_);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        {
+            std::fprintf(stderr, "Incomplete %dx%d framebuffer\n", w, h);
+            std::exit(1);
+        }
+
+        glGenBuffers(kReadbacks, pbo_);
+        for (GLuint b : pbo_)
+        {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, b);
+            glBufferStorage(GL_PIXEL_PACK_BUFFER, bytes_, nullptr, GL_MAP_READ_BIT);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+
+    ~Readback()
+    {
+        for (GLsync &f : fences_)
+            if (f)
+                glDeleteSync(f);
+        glDeleteBuffers(kReadbacks, pbo_);
+        glDeleteRenderbuffers(1, &color_);
+        glDeleteFramebuffers(1, &fbo_);
+    }
+
+    Readback(const Readback &) = delete;
+    Readback &operator=(const Readback &) = delete;
+
+    void bind() const { glBindFramebuffer(GL_FRAMEBUFFER, fbo_); }
+
+    // Start copying the framebuffer out as `frame`; its slot must be unmapped
+    void read(uint64_t frame)
+    {
+        const int s = int(frame % kReadbacks);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo_[s]);
+        glReadPixels(0, 0, w_, h_, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        fences_[s] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+
+    // Pixels of an earlier read(frame), valid until unmap()
+    const uint8_t *map(uint64_t frame)
+    {
+        const int s = int(frame % kReadbacks);
+        if (GLsync f = fences_[s])
+        {
+            while (glClientWaitSync(f, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull) == GL_TIMEOUT_EXPIRED)
+                ;
+            glDeleteSync(f);
+            fences_[s] = nullptr;
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo_[s]);
+        return static_cast<const uint8_t *>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bytes_, GL_MAP_READ_BIT));
+    }
+
+    void unmap()
+    {
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+
+private:
+    int w_, h_;
+    size_t bytes_;
+    GLuint fbo_ = 0, color_ = 0;
+    GLuint pbo_[kReadbacks] = {};
+    GLsync fences_[kReadbacks] = {};
+};
+
+// Renders frames as the analysis passes their time. Events of a hop all
+// depict the centre of its window and hops arrive in order, so every frame
+// before that centre is final once the hop is in.
+class VideoSink : public HopSink
+{
+public:
+    VideoSink(const VideoOptions &opt, FrameWriter &out)
+        : opt_(opt), out_(out), store_(std::make_unique<CircleStore>()), readback_(opt.width, opt.height)
+    {
+        if (opt.trails)
+            trails_ = std::make_unique<TrailRenderer>(kCircleLife);
+    }
+
+    bool begin(int rate) override
+    {
+        rate_ = rate;
+        return true;
+    }
+
+    void hop(const HopFeatures &f, const CircleEvent *events, uint32_t count) override
+    {
+        (void)f;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            const CircleEvent &e = events[i];
+            const uint64_t centre = e.sample + e.span / 2;
+            render_until(centre);
+
+            Circle c;
+            c.x = e.x;
+            c.y = e.y;
+            c.sample = centre;
+            c.radius = e.radius;
+            c.falloff = e.falloff;
+            c.intensity = e.intensity;
+            if (!store_->push(c, float(double(centre) / rate_)))
+                stats().circles_evicted.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // Render the remaining frames up to frames in total and drain the readbacks
+    void finish(uint64_t frames)
+    {
+        while (ok_ && rendered_ < frames)
+            render_frame();
+        while (ok_ && written_ < rendered_)
+            write_frame();
+    }
+
+    bool ok() const { return ok_; }
+    uint64_t frames() const { return written_; }
+
+private:
+    // Every frame whose time is before sample
+    void render_until(uint64_t sample)
+    {
+        while (ok_ && rendered_ * (uint64_t)rate_ < sample * (uint64_t)opt_.fps)
+            render_frame();
+    }
+
+    void render_frame()
+    {
+        if (rendered_ - written_ == Readback::kReadbacks)
+            write_frame();
+        if (!ok_)
+            return;
+
+        ScopedTimer render_timer(Stage::Render);
+        const float now = float(double(rendered_) / opt_.fps);
+        readback_.bind();
+        if (trails_)
+        {
+            trails_->draw(renderer_, *store_, now, 1.0f / opt_.fps, opt_.width, opt_.height);
+            store_->clear();
+        }
+        else
+        {
+            store_->expire(now, float(kCircleLife));
+            renderer_.draw(*store_, now, opt_.width, opt_.height);
+        }
+        readback_.read(rendered_++);
+    }
+
+    void write_frame()
+    {
+        const uint8_t *pixels = readback_.map(written_);
+        ok_ = pixels && out_.write(pixels);
+        readback_.unmap();
+        written_++;
+    }
+
+    const VideoOptions &opt_;
+    FrameWriter &out_;
+    std::unique_ptr<CircleStore> store_; // live circles, or with trails those since the last frame
+    CircleRenderer renderer_;
+    std::unique_ptr<TrailRenderer> trails_;
+    Readback readback_;
+    int rate_ = 0;
+    uint64_t rendered_ = 0; // frames drawn and queued for readback
+    uint64_t written_ = 0;  // frames handed to out_
+    bool ok_ = true;
+};
+
+} // namespace
+
+int render_video(const VideoOptions &opt)
+{
+    if (opt.width <= 0 || opt.height <= 0 || opt.fps <= 0)
+    {
+        std::fprintf(stderr, "Bad video size or frame rate\n");
+        return 1;
+    }
+    if (opt.format != "y4m" && opt.format != "rgba")
+    {
+        std::fprintf(stderr, "Unknown video format: %s\n", opt.format.c_str());
+        return 1;
+    }
+    if (opt.format == "y4m" && (opt.width % 2 || opt.height % 2))
+    {
+        std::fprintf(stderr, "y4m output needs an even width and height\n");
+        return 1;
+    }
+
+    const auto t_start = std::chrono::steady_clock::now();
+    HeadlessContext context;
+    FrameWriter out(opt);
+    if (!out.ok())
+    {
+        std::perror(opt.output.c_str());
+        return 1;
+    }
+
+    uint64_t frames = 0;
+    bool ok;
+    {
+        VideoSink sink(opt, out);
+        FileStats st = analyze_stream(opt.input, opt.params, sink);
+        if (st.ok)
+            sink.finish((uint64_t)std::ceil(st.audio_sec * opt.fps - 1e-6));
+        frames = sink.frames();
+        ok = st.ok && sink.ok();
+    }
+    if (!ok)
+    {
+        if (!out.ok())
+            std::perror(opt.output.c_str());
+        return 1;
+    }
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count();
+    double video_sec = double(frames) / opt.fps;
+    std::fprintf(stderr, "%s: %llu frames (%dx%d, %d fps, %.1f s) in %.2f s (%.1fx realtime)\n",
+                 opt.input.c_str(), (unsigned long long)frames, opt.width, opt.height, opt.fps, video_sec,
+                 elapsed, video_sec / std::max(elapsed, 1e-9));
+    return 0;
+}
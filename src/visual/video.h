@@ -0,0 +1,26 @@
+#ifndef VIDEO_H
+#define VIDEO_H
+
+#include <string>
+
+#include "analysis.h"
+
+// Render a file's circles to video without a window or playback, as fast as
+// analysis and the GPU allow. Frame f shows the stream at sample
+// f * rate / fps, so timing follows the audio, not the wall clock.
+struct VideoOptions
+{
+    std::string input;
+    std::string output;         // file, or - for stdout
+    std::string format = "y4m"; // "y4m" (YUV4MPEG2, 4:2:0) or "rgba" (raw frames, top row first)
+    int width = 1920;
+    int height = 1080;
+    int fps = 60;
+    bool trails = false;        // see VisualOptions
+    AnalysisParams params;
+};
+
+// Returns a process exit code
+int render_video(const VideoOptions &opt);
+
+#endif
@@ -1,134 +1,95 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
+#include <algorithm>
+#include <memory>
 
 #include "visual.h"
 #include "init.h"
-#include "loader.h"
 #include "circle.h"
+#include "circle_renderer.h"
+#include "circle_store.h"
+#include "trail_renderer.h"
+#include "../stats.h"
 
-void visual_thread(SharedState *shared)
+void visual_thread(SharedState *shared, VisualOptions opt)
 {
     GLFWwindow *win = init_window();
 
-    GLuint prog = LoadShaderProgram(
-        "src/shaders/circle.vert",
-        "src/shaders/circle.frag");
-
-    GLuint vao = 0;
-    glGenVertexArrays(1, &vao);
-    glBindVertexArray(vao);
-
-    // Uniform locations
-    GLint locCount = glGetUniformLocation(prog, "uCount");
-    GLint locPos = glGetUniformLocation(prog, "uPos");
-    GLint locAge = glGetUniformLocation(prog, "uAge");
-    GLint locLife = glGetUniformLocation(prog, "uLife");
-    GLint locRadius = glGetUniformLocation(prog, "uRadius");
-    GLint locDotSpacing = glGetUniformLocation(prog, "uDotSpacing");
-    GLint locDotRadius = glGetUniformLocation(prog, "uDotRadius");
-    // per-circle params
-    GLint locRadiusArr = glGetUniformLocation(prog, "uRadiusArr");
-    GLint locFalloffArr = glGetUniformLocation(prog, "uFalloffArr");
-    GLint locIntensityArr = glGetUniformLocation(prog, "uIntensityArr");
+    // Live circles and the program that draws them. With trails the store
+    // only holds the circles released since the last frame.
+    auto store = std::make_unique<CircleStore>();
+    auto renderer = std::make_unique<CircleRenderer>();
+    std::unique_ptr<TrailRenderer> trails;
+    if (opt.trails)
+        trails = std::make_unique<TrailRenderer>(kCircleLife);
 
     // attach shared state to the window so legacy add_circle(win,...) works
     glfwSetWindowUserPointer(win, shared);
 
+    // Render clock epoch: births and uNow are float seconds since here
     double t0 = glfwGetTime();
 
+    // A frame is late when it takes more than 1.5 refresh periods
+    const GLFWvidmode *mode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+    const int refresh_hz = (mode && mode->refreshRate > 0) ? mode->refreshRate : 60;
+    const uint64_t frame_budget_ns = 1500000000ull / (uint64_t)refresh_hz;
+    uint64_t last_swap_ns = 0;
+    float last_now = 0.0f;
+
     // Render loop
     while (!glfwWindowShouldClose(win) && shared->running)
     {
         glfwPollEvents();
+        ScopedTimer render_timer(Stage::Render);
 
-        int w, h;
-        glfwGetFramebufferSize(win, &w, &h);
-        glViewport(0, 0, w, h);
-
-        // Black background
-        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
-
-        double now = glfwGetTime();
+        const float now = float(glfwGetTime() - t0);
 
-        // Remove expired circles under lock and copy current list to a local vector
-        std::vector<Circle> localCircles;
+        // Release circles whose sound is audible now. The queue is in sample
+        // order, so the head is the next one due; its birth is back-dated by
+        // how late this frame picks it up so the animation stays in phase.
         {
-            std::lock_guard<std::mutex> lk(shared->mtx);
-            // initialize t0 for any circles added by flux (t0==0)
-            for (Circle &c : shared->circles) {
-                if (c.t0 <= 0.0)
-                    c.t0 = now;
+            SYN_TIME(Stage::CircleDrain);
+            const int rate = shared->clock.rate();
+            const double heard =
+                shared->clock.position(SampleClock::now_ns()) - shared->av_offset_sec * rate;
+            while (shared->circle_events.size() > 0 && double(shared->circle_events.peek()->sample) <= heard)
+            {
+                Circle c;
+                shared->circle_events.pop(&c, 1);
+                double late = rate > 0 ? (heard - double(c.sample)) / rate : 0.0;
+                if (!store->push(c, now - float(std::min(late, kCircleLife))))
+                    stats().circles_evicted.fetch_add(1, std::memory_order_relaxed);
             }
-            for (size_t i = 0; i < shared->circles.size();) {
-                if (now - shared->circles[i].t0 >= kCircleLife)
-                    shared->circles.erase(shared->circles.begin() + i);
-                else
-                    ++i;
-            }
-            localCircles = shared->circles; // copy for rendering work without holding lock
         }
 
-        // Prepare arrays for uniforms from local copy
-        int count = (int)localCircles.size();
-        std::vector<float> posData;
-        posData.reserve(count * 2);
-        std::vector<float> ageData;
-        ageData.reserve(count);
-        std::vector<float> radiusData;
-        radiusData.reserve(count);
-        std::vector<float> falloffData;
-        falloffData.reserve(count);
-        std::vector<float> intensityData;
-        intensityData.reserve(count);
-        for (const Circle &c : localCircles)
+        int w, h;
+        glfwGetFramebufferSize(win, &w, &h);
+        if (trails)
         {
-            posData.push_back(c.x);
-            posData.push_back(c.y);
-            ageData.push_back(float(now - c.t0));
-            radiusData.push_back(c.radius);
-            falloffData.push_back(c.falloff);
-            intensityData.push_back(c.intensity);
+            trails->draw(*renderer, *store, now, now - last_now, w, h);
+            store->clear();
         }
-
-        // Use program and upload uniforms
-        glUseProgram(prog);
-        glUniform1i(locCount, count);
-        glUniform1f(locLife, float(kCircleLife));
-        // set dotted-circle params (tweak these to taste)
-        float radius = 0.05f;      // main circle radius in UV
-        float dotSpacing = 0.001f; // spacing between dots in UV
-        float dotRadius = 0.0005f; // small dot radius in UV
-        if (locRadius >= 0)
-            glUniform1f(locRadius, radius);
-        if (locDotSpacing >= 0)
-            glUniform1f(locDotSpacing, dotSpacing);
-        if (locDotRadius >= 0)
-            glUniform1f(locDotRadius, dotRadius);
-        if (count > 0)
+        else
         {
-            // std::this_thread::sleep_for(std::chrono::milliseconds(50));
-            // upload vec2 array (count elements)
-            glUniform2fv(locPos, count, posData.data());
-            glUniform1fv(locAge, count, ageData.data());
-            if (locRadiusArr >= 0)
-                glUniform1fv(locRadiusArr, count, radiusData.data());
-            if (locFalloffArr >= 0)
-                glUniform1fv(locFalloffArr, count, falloffData.data());
-            if (locIntensityArr >= 0)
-                glUniform1fv(locIntensityArr, count, intensityData.data());
+            store->expire(now, float(kCircleLife));
+            renderer->draw(*store, now, w, h);
         }
+        last_now = now;
+        render_timer.stop();
 
-        // Draw full-screen triangle (3 verts)
-        glBindVertexArray(vao);
-        glDrawArrays(GL_TRIANGLES, 0, 3);
-
-        glfwSwapBuffers(win);
+        {
+            SYN_TIME(Stage::Swap);
+            glfwSwapBuffers(win);
+        }
+        uint64_t swap_ns = stats_now_ns();
+        if (last_swap_ns && swap_ns - last_swap_ns > frame_budget_ns)
+            stats().frames_over_budget.fetch_add(1, std::memory_order_relaxed);
+        last_swap_ns = swap_ns;
     }
 
-    // Cleanup
-    glDeleteVertexArrays(1, &vao);
-    glDeleteProgram(prog);
+    // Cleanup, while the context is still current
+    trails.reset();
+    renderer.reset();
 
     glfwDestroyWindow(win);
     glfwTerminate();
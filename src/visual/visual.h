@@ -3,6 +3,12 @@
 
 #include "../shared_state.h"
 
-void visual_thread(SharedState *shared);
+// Options of the window
+struct VisualOptions
+{
+    bool trails = false; // TrailRenderer: accumulate and decay instead of redrawing live circles
+};
+
+void visual_thread(SharedState *shared, VisualOptions opt = {});
 
 #endif
@@ -0,0 +1,114 @@
+// fft_test: every FFT kernel the CPU supports against the scalar butterflies
+// and the fft_inplace reference, in both precisions, at every power-of-2
+// size from 2 to 32768 (odd and even log2 take different last stages in the
+// vector kernels). Exit status 1 on any mismatch.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "fourier.h"
+
+namespace
+{
+
+// Largest |X[k] - ref[k]| relative to the largest |ref[k]|
+template <typename C>
+double max_rel_error(const std::vector<C> &X, const std::vector<cd> &ref)
+{
+    double err = 0.0, peak = 0.0;
+    for (size_t k = 0; k < ref.size(); ++k)
+    {
+        cd x(double(X[k].real()), double(X[k].imag()));
+        err = std::max(err, std::abs(x - ref[k]));
+        peak = std::max(peak, std::abs(ref[k]));
+    }
+    return err / std::max(peak, 1e-300);
+}
+
+template <typename T>
+int check(FftIsa isa, size_t n, const std::vector<cd> &in, const std::vector<cd> &ref, double tol)
+{
+    using C = std::complex<T>;
+    int failures = 0;
+    auto report = [&](const char *what, double err) {
+        if (err <= tol)
+            return;
+        std::printf("FAIL %-10s %-6s %-6s n=%-6zu error %.3g > %.3g\n", what, sizeof(T) == 4 ? "f32" : "f64",
+                    fft_isa_name(isa), n, err, tol);
+        ++failures;
+    };
+
+    // Complex plan on this ISA, against the reference and the scalar plan
+    std::vector<C> X(n), S(n);
+    for (size_t i = 0; i < n; ++i)
+        X[i] = S[i] = C(T(in[i].real()), T(in[i].imag()));
+    BasicFftPlan<T>(n, isa).execute(X.data());
+    BasicFftPlan<T>(n, FftIsa::Scalar).execute(S.data());
+    report("complex", max_rel_error(X, ref));
+    std::vector<cd> scalar(n);
+    for (size_t i = 0; i < n; ++i)
+        scalar[i] = cd(S[i].real(), S[i].imag());
+    report("vs-scalar", max_rel_error(X, scalar));
+
+    // Real FFT of the real parts (its n/2-point plan runs the same kernels)
+    if (n >= 4)
+    {
+        std::vector<T> x(n);
+        std::vector<cd> r(n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            x[i] = T(in[i].real());
+            r[i] = cd(double(x[i]), 0.0);
+        }
+        fft_inplace(r);
+        r.resize(n / 2 + 1);
+        std::vector<C> R(n / 2 + 1);
+        BasicRealFft<T> rfft(n, isa);
+        rfft.forward(x.data(), R.data());
+        report("real", max_rel_error(R, r));
+
+        std::vector<T> back(n);
+        rfft.inverse(R.data(), back.data());
+        double err = 0.0;
+        for (size_t i = 0; i < n; ++i)
+            err = std::max(err, std::abs(double(back[i]) - double(x[i])));
+        report("inverse", err);
+    }
+    return failures;
+}
+
+} // namespace
+
+int main()
+{
+    const FftIsa best = fft_detect_isa();
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> u(-1.0, 1.0);
+    int failures = 0, runs = 0;
+
+    for (int log2n = 1; log2n <= 15; ++log2n)
+    {
+        const size_t n = size_t(1) << log2n;
+        std::vector<cd> in(n);
+        for (cd &c : in)
+            c = cd(u(rng), u(rng));
+        std::vector<cd> ref = in;
+        fft_inplace(ref);
+
+        for (FftIsa isa : {FftIsa::Scalar, FftIsa::Sse2, FftIsa::Avx2, FftIsa::Avx512})
+        {
+            if (isa > best)
+                break;
+            // fft_inplace's twiddle recurrence is itself off by ~5e-13 at 32768
+            failures += check<double>(isa, n, in, ref, 1e-11);
+            failures += check<float>(isa, n, in, ref, 2e-6 * log2n);
+            runs += 2;
+        }
+    }
+
+    std::printf("fft_test: %d checks on up to %s, %d failures\n", runs, fft_isa_name(best), failures);
+    return failures ? 1 : 0;
+}